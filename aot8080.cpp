@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+#include "aot8080.h"
+#include "blocks8080.h"
+#include "ops8080.h"
+
+//Prints value as a C++ hex literal with at least digits digits.
+static std::ostream& Hex(std::ostream& out, const unsigned value, const int digits) {
+    return out << "0x" << std::hex << std::setw(digits) << std::setfill('0') << value << std::dec;
+}
+
+//Instructions that need state->pc to point past them: the ones that read or replace it, and stores,
+//IN and OUT included, after which a compiled block may have to hand pc to the interpreter.
+static bool NeedsPc(const int op) {
+    return EndsBlock(op) || StoresToMemory(op);
+}
+
+//Jumps, returns and PCHL never fall through to the next instruction.
+static bool FallsThrough(const int op) {
+    return op != 0xc3 && op != 0xcb && op != 0xc9 && op != 0xd9 && op != 0xe9;
+}
+
+static void WriteBlock(const CodeBlock* block, std::ostream& out) {
+    out << "static RunResult Block_";
+    out << std::hex << std::setw(4) << std::setfill('0') << block->start << std::dec;
+    out << "(State8080* state) {\n";
+    out << "    uint64_t cycles = 0;\n";
+
+    uint16_t address = block->start;
+    for (size_t i = 0; i < block->ops.size(); i++) {
+        const DecodedOp& op = block->ops[i];
+        address += op.length;
+        const bool last = i + 1 == block->ops.size();
+
+        if (NeedsPc(op.opcode)) {
+            out << "    state->pc = ";
+            Hex(out, address, 4) << ";\n";
+        }
+        out << "    cycles += Execute<";
+        Hex(out, op.opcode, 2) << ", DefaultFlags>(state, ";
+        Hex(out, op.operand, op.length == 3 ? 4 : 2) << ");\n";
+        if (StoresToMemory(op.opcode) && !last) {
+            out << "    if (state->aot->entry[";
+            Hex(out, block->start, 4) << "] == nullptr)\n";
+            out << "        return {cycles, " << i + 1 << "};\n";
+        }
+        if (last && !EndsBlock(op.opcode)) {
+            out << "    state->pc = ";
+            Hex(out, address, 4) << ";\n";
+        }
+    }
+
+    out << "    return {cycles, " << block->ops.size() << "};\n";
+    out << "}\n\n";
+}
+
+size_t WriteAotSource(const uint8_t* image, const size_t size, std::ostream& out) {
+    std::unique_ptr<uint8_t[]> memory(new uint8_t[0x10000]());
+    std::copy(image, image + std::min<size_t>(size, 0x10000), memory.get());
+    State8080 state = {};
+    state.memory = memory.get();
+
+    //The block cache splits the code exactly the way the block interpreter would.
+    std::unique_ptr<BlockCache> cache(new BlockCache());
+    std::vector<uint16_t> pending;
+    for (int vector = 0; vector < 0x40; vector += 8) {
+        if (static_cast<size_t>(vector) < size)
+            pending.push_back(vector);
+    }
+
+    while (!pending.empty()) {
+        const uint16_t start = pending.back();
+        pending.pop_back();
+        if (cache->blocks[start])
+            continue;
+
+        const CodeBlock* block = FindBlock(cache.get(), &state, start);
+        const DecodedOp& last = block->ops.back();
+        const uint16_t next = block->start + block->length;
+        std::vector<uint16_t> targets;
+        if (FallsThrough(last.opcode))
+            targets.push_back(next);
+        if ((last.opcode & 0xc7) == 0xc2 || (last.opcode & 0xc7) == 0xc4 || last.opcode == 0xc3 ||
+            last.opcode == 0xcb || (last.opcode & 0xcf) == 0xcd)
+            targets.push_back(last.operand);   //Jcc, Ccc, JMP, CALL
+        else if ((last.opcode & 0xc7) == 0xc7)
+            targets.push_back(last.opcode & 0x38);
+
+        for (const uint16_t target : targets) {
+            if (target < size && !cache->blocks[target])
+                pending.push_back(target);
+        }
+    }
+
+    out << "//Generated by 8080_emulator -a. Link it in with the I8080_AOT_SOURCE CMake option and\n"
+           "//generate it again whenever the image changes.\n"
+           "#include \"aot8080.h\"\n"
+           "#include \"ops8080.h\"\n\n";
+
+    for (const std::unique_ptr<CodeBlock>& block : cache->blocks) {
+        if (block)
+            WriteBlock(block.get(), out);
+    }
+
+    out << "static const AotBlock blocks[] = {\n";
+    for (const std::unique_ptr<CodeBlock>& block : cache->blocks) {
+        if (!block)
+            continue;
+        out << "    {";
+        Hex(out, block->start, 4) << ", " << block->length << ", " << block->lead_cycles << ", Block_";
+        out << std::hex << std::setw(4) << std::setfill('0') << block->start << std::dec << "},\n";
+    }
+    out << "};\n\n";
+
+    out << "static const uint8_t image[] = {";
+    for (size_t i = 0; i < size; i++) {
+        out << (i % 16 == 0 ? "\n    " : " ");
+        Hex(out, image[i], 2) << ",";
+    }
+    out << "\n};\n\n";
+
+    out << "extern const AotImage aot_image = {blocks, " << cache->compiled << ", image, sizeof(image)};\n";
+
+    return cache->compiled;
+}
+
+#ifdef I8080_AOT
+extern const AotImage aot_image;
+
+const AotImage* LinkedAotImage() {
+    return &aot_image;
+}
+#else
+const AotImage* LinkedAotImage() {
+    return nullptr;
+}
+#endif
+
+size_t AttachAot(AotProgram* program, const AotImage* image, const State8080* state) {
+    size_t attached = 0;
+    for (size_t i = 0; i < image->count; i++) {
+        const AotBlock& block = image->blocks[i];
+        bool matches = true;
+        for (int j = 0; j < block.length && matches; j++) {
+            const uint16_t address = block.start + j;
+            matches = Read8(state, address) == (address < image->size ? image->image[address] : 0);
+        }
+        if (!matches || program->entry[block.start] != nullptr)
+            continue;
+
+        program->entry[block.start] = &block;
+        for (int j = 0; j < block.length; j++)
+            program->cover[static_cast<uint16_t>(block.start + j)]++;
+        attached++;
+    }
+
+    return attached;
+}
+
+void InvalidateAot(AotProgram* program, const uint16_t address) {
+    for (int back = 0; back < MAX_BLOCK_BYTES; back++) {
+        const uint16_t start = address - back;
+        const AotBlock* block = program->entry[start];
+        if (block == nullptr || block->length <= back)
+            continue;
+
+        for (int i = 0; i < block->length; i++)
+            program->cover[static_cast<uint16_t>(start + i)]--;
+        program->entry[start] = nullptr;
+        program->invalidations++;
+    }
+}
+
+RunResult RunAot(State8080* state, const uint64_t cycle_budget) {
+    AotProgram* program = state->aot;
+    RunResult result = {0, 0};
+
+    while (result.cycles < cycle_budget && !state->halted) {
+        const AotBlock* block = program->entry[state->pc];
+        //Only the last instruction can take more than its listed cycles, as in RunCodeBlock, so a
+        //block that cannot reach the budget before it runs all of it.
+        if (block != nullptr && result.cycles + block->lead_cycles < cycle_budget) {
+            const RunResult run = block->run(state);
+            result.cycles += run.cycles;
+            result.instructions += run.instructions;
+            program->compiled_instructions += run.instructions;
+        } else {
+            result.cycles += step_table<DefaultFlags>[Read8(state, state->pc)](state);
+            result.instructions++;
+            program->interpreted_instructions++;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,64 @@
+#ifndef AOT8080_H
+#define AOT8080_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "cpu8080.h"
+
+//Runs one block compiled ahead of time from start to its last instruction, or until a store into
+//compiled code drops the block.
+typedef RunResult (*AotFunction)(State8080* state);
+
+//A block of the traced image, split by the same rules as CodeBlock.
+typedef struct AotBlock {
+    uint16_t    start;
+    uint16_t    length;         //bytes covered, starting at start
+    uint32_t    lead_cycles;    //cycles of every instruction but the last
+    AotFunction run;
+} AotBlock;
+
+//What a translation unit written by WriteAotSource exports: its blocks, and the image they were
+//traced from so that AttachAot can check memory still holds the same code.
+typedef struct AotImage {
+    const AotBlock  *blocks;
+    size_t      count;
+    const uint8_t   *image;     //loaded at address 0
+    size_t      size;
+} AotImage;
+
+//The compiled blocks that match memory, indexed by start address. cover counts the blocks that
+//include each byte, like BlockCache::cover; a store into one drops every block it hits for good and
+//that code is interpreted from then on.
+typedef struct AotProgram {
+    std::array<const AotBlock*, 0x10000>    entry;
+    std::array<uint8_t, 0x10000>    cover;
+    uint64_t    compiled_instructions;      //run by compiled blocks
+    uint64_t    interpreted_instructions;   //run by the interpreter, outside compiled code or at the budget
+    uint64_t    invalidations;
+} AotProgram;
+
+//Traces the code reachable from the reset and RST vectors of image, following jumps, calls and the
+//fall-through of conditional branches, and writes a C++ translation unit with one function per
+//block. Indirect jumps (PCHL) and returns end the trace, so code reached only through them is left
+//to the interpreter. Returns the number of blocks written.
+size_t WriteAotSource(const uint8_t* image, size_t size, std::ostream& out);
+
+//The image compiled into this build from the file named by the I8080_AOT_SOURCE CMake option, or
+//nullptr when there is none.
+const AotImage* LinkedAotImage();
+
+//Adds every block of image whose bytes still match memory to program. Returns the number added.
+size_t AttachAot(AotProgram* program, const AotImage* image, const State8080* state);
+
+//Drops every compiled block that includes address. Write8 calls this for stores into compiled code.
+void InvalidateAot(AotProgram* program, uint16_t address);
+
+//Run8080 on a state with an AotProgram attached. Runs compiled blocks where there is one for pc and
+//the budget allows the whole block, and the interpreter everywhere else. Leaves lazy flags pending
+//on return.
+RunResult RunAot(State8080* state, uint64_t cycle_budget);
+
+#endif //AOT8080_H
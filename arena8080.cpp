@@ -0,0 +1,242 @@
+#include <cstring>
+#include <fstream>
+#include <new>
+
+#include "arena8080.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ARENA_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#define ARENA_MEMFD 1
+#else
+#define ARENA_MEMFD 0
+#endif
+#else
+#define ARENA_MMAP 0
+#define ARENA_MEMFD 0
+#endif
+
+constexpr size_t ARENA_SIZE = 0x10000;
+
+#if ARENA_MMAP
+
+//Reserves size bytes of inaccessible address space with one guard page on either side and returns
+//the first byte after the front guard.
+static uint8_t* Reserve(MemoryArena* arena, const size_t size) {
+    const size_t guard = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    void* mapping = mmap(nullptr, guard + size + guard, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+
+    arena->mapping = static_cast<uint8_t*>(mapping);
+    arena->mapped = guard + size + guard;
+    return arena->mapping + guard;
+}
+
+static bool MapGuarded(MemoryArena* arena) {
+    uint8_t* memory = Reserve(arena, ARENA_SIZE);
+    if (memory == nullptr)
+        return false;
+    if (mprotect(memory, ARENA_SIZE, PROT_READ | PROT_WRITE) != 0) {
+        munmap(arena->mapping, arena->mapped);
+        return false;
+    }
+
+    arena->memory = memory;
+    arena->layout = ARENA_GUARDED;
+    return true;
+}
+
+//Both copies map the same memfd over the reserved space, so a store through either shows in the other.
+static bool MapMirrored(MemoryArena* arena) {
+#if ARENA_MEMFD
+    const int fd = memfd_create("8080_memory", 0);
+    if (fd < 0)
+        return false;
+    uint8_t* memory = ftruncate(fd, ARENA_SIZE) == 0 ? Reserve(arena, 2 * ARENA_SIZE) : nullptr;
+    bool mapped = memory != nullptr;
+    for (size_t copy = 0; copy < 2 && mapped; copy++) {
+        mapped = mmap(memory + copy * ARENA_SIZE, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+                      0) != MAP_FAILED;
+    }
+    close(fd);
+    if (!mapped) {
+        if (memory != nullptr)
+            munmap(arena->mapping, arena->mapped);
+        return false;
+    }
+
+    arena->memory = memory;
+    arena->layout = ARENA_MIRRORED;
+    return true;
+#else
+    return false;
+#endif
+}
+
+#endif
+
+MemoryArena* CreateArena(const ArenaLayout preferred) {
+    MemoryArena* arena = new (std::nothrow) MemoryArena();
+    if (arena == nullptr)
+        return nullptr;
+
+#if ARENA_MMAP
+    if (preferred == ARENA_MIRRORED && MapMirrored(arena))
+        return arena;
+    if (preferred != ARENA_HEAP && MapGuarded(arena))
+        return arena;
+#endif
+
+    arena->memory = new (std::nothrow) uint8_t[ARENA_SIZE]();
+    arena->layout = ARENA_HEAP;
+    if (arena->memory == nullptr) {
+        delete arena;
+        return nullptr;
+    }
+    return arena;
+}
+
+void DestroyArena(MemoryArena* arena) {
+    if (arena == nullptr)
+        return;
+#if ARENA_MMAP
+    if (arena->layout != ARENA_HEAP)
+        munmap(arena->mapping, arena->mapped);
+    else
+        delete[] arena->memory;
+#else
+    delete[] arena->memory;
+#endif
+    delete arena;
+}
+
+ArenaImage* CreateArenaImage(const uint8_t* memory) {
+    ArenaImage* image = new (std::nothrow) ArenaImage();
+    if (image == nullptr)
+        return nullptr;
+    image->fd = -1;
+
+#if ARENA_MEMFD
+    //Filled with pwrite so that no writable shared mapping of it ever exists.
+    const int fd = memfd_create("8080_image", 0);
+    if (fd >= 0 && ftruncate(fd, ARENA_SIZE) == 0 && pwrite(fd, memory, ARENA_SIZE, 0) == static_cast<ssize_t>(ARENA_SIZE)) {
+        void* view = mmap(nullptr, ARENA_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+        if (view != MAP_FAILED) {
+            image->memory = static_cast<const uint8_t*>(view);
+            image->fd = fd;
+            return image;
+        }
+    }
+    if (fd >= 0)
+        close(fd);
+#endif
+
+    uint8_t* copy = new (std::nothrow) uint8_t[ARENA_SIZE];
+    if (copy == nullptr) {
+        delete image;
+        return nullptr;
+    }
+    std::memcpy(copy, memory, ARENA_SIZE);
+    image->memory = copy;
+    return image;
+}
+
+void DestroyArenaImage(ArenaImage* image) {
+    if (image == nullptr)
+        return;
+#if ARENA_MEMFD
+    if (image->fd >= 0) {
+        munmap(const_cast<uint8_t*>(image->memory), ARENA_SIZE);
+        close(image->fd);
+        delete image;
+        return;
+    }
+#endif
+    delete[] image->memory;
+    delete image;
+}
+
+MemoryArena* CloneArena(const ArenaImage* image) {
+#if ARENA_MEMFD
+    if (image->fd >= 0) {
+        MemoryArena* arena = new (std::nothrow) MemoryArena();
+        if (arena == nullptr)
+            return nullptr;
+        uint8_t* memory = Reserve(arena, ARENA_SIZE);
+        if (memory != nullptr && mmap(memory, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                                      image->fd, 0) != MAP_FAILED) {
+            arena->memory = memory;
+            arena->layout = ARENA_GUARDED;
+            return arena;
+        }
+        if (memory != nullptr)
+            munmap(arena->mapping, arena->mapped);
+        delete arena;
+        return nullptr;
+    }
+#endif
+
+    MemoryArena* arena = CreateArena(ARENA_GUARDED);
+    if (arena != nullptr)
+        std::memcpy(arena->memory, image->memory, ARENA_SIZE);
+    return arena;
+}
+
+#if ARENA_MMAP
+
+LoadStatus LoadImage(MemoryArena* arena, const char* path, const uint16_t address, size_t* size) {
+    const int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        if (fd >= 0)
+            close(fd);
+        return LOAD_NOT_FOUND;
+    }
+    *size = static_cast<size_t>(info.st_size);
+    if (*size > ARENA_SIZE - address) {
+        close(fd);
+        return LOAD_TOO_LARGE;
+    }
+
+    //The tail of the last host page past the end of the file maps as zeros, like the rest of a fresh
+    //arena.
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    bool loaded = *size == 0;
+    if (!loaded && arena->layout == ARENA_GUARDED && address % page == 0) {
+        loaded = mmap(arena->memory + address, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) !=
+                 MAP_FAILED;
+    }
+    for (size_t done = 0; !loaded && done < *size;) {
+        const ssize_t got = pread(fd, arena->memory + address + done, *size - done, static_cast<off_t>(done));
+        if (got <= 0)
+            break;
+        done += static_cast<size_t>(got);
+        loaded = done == *size;
+    }
+    close(fd);
+
+    return loaded ? LOAD_OK : LOAD_READ_ERROR;
+}
+
+#else
+
+LoadStatus LoadImage(MemoryArena* arena, const char* path, const uint16_t address, size_t* size) {
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return LOAD_NOT_FOUND;
+    *size = static_cast<size_t>(file.tellg());
+    if (*size > ARENA_SIZE - address)
+        return LOAD_TOO_LARGE;
+
+    file.seekg(0, std::ios::beg);
+    return file.read(reinterpret_cast<char*>(arena->memory + address), static_cast<std::streamsize>(*size))
+               ? LOAD_OK
+               : LOAD_READ_ERROR;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ARENA8080_H
+#define ARENA8080_H
+
+#include <cstddef>
+#include <cstdint>
+
+//How the 64K of a machine is laid out in host memory.
+enum ArenaLayout : uint8_t {
+    ARENA_HEAP,         //a plain allocation, for hosts without mmap
+    ARENA_GUARDED,      //inaccessible pages before and after, so host code that runs off either end faults
+    ARENA_MIRRORED,     //the same 64K mapped twice in a row, so memory[0x10000 + i] is memory[i], with
+                        //guard pages around both copies
+};
+
+//The memory of one machine, page aligned. Emulated accesses all use 16-bit addresses and never leave
+//it; the layout decides what happens to host code that reads past the top, such as a decoder fetching
+//the operands of an instruction at 0xffff.
+typedef struct MemoryArena {
+    uint8_t     *memory;    //0x10000 bytes, zeroed
+    ArenaLayout layout;
+    uint8_t     *mapping;   //the whole mapping, guard pages included
+    size_t      mapped;
+} MemoryArena;
+
+//Maps an arena with the preferred layout, or the next best one the host can do: mirroring needs
+//Linux memfd_create, guard pages any POSIX mmap. Returns nullptr only when memory runs out.
+MemoryArena* CreateArena(ArenaLayout preferred);
+void DestroyArena(MemoryArena* arena);
+
+//A frozen copy of a machine's 64K, typically taken right after booting, that any number of clones
+//map copy-on-write. The host shares each page of it between all clones until one of them stores to
+//it, so a clone costs one mapping plus the host pages it dirties instead of 64K.
+typedef struct ArenaImage {
+    const uint8_t   *memory;    //read-only view of the image, e.g. the baseline for RestoreDirtyPages
+    int         fd;             //the memfd clones map, -1 when the host has none and clones copy
+} ArenaImage;
+
+//Copies memory into a new image. Returns nullptr only when memory runs out.
+ArenaImage* CreateArenaImage(const uint8_t* memory);
+void DestroyArenaImage(ArenaImage* image);
+
+//A guarded arena holding image, mapped privately so stores stay in the clone. Without memfd it is a
+//plain copy. Clones outlive the image they came from. Returns nullptr when memory runs out.
+MemoryArena* CloneArena(const ArenaImage* image);
+
+enum LoadStatus : uint8_t {
+    LOAD_OK,
+    LOAD_NOT_FOUND,     //the file cannot be opened
+    LOAD_TOO_LARGE,     //it does not fit between the load address and the top of memory
+    LOAD_READ_ERROR,
+};
+
+//Puts the file at path into arena at address and sets size to its length. Into a guarded arena at an
+//address on a host page boundary the file is mapped privately rather than copied: its pages are the
+//page cache's, shared read-only with every other process that maps it, until the machine stores to
+//one. Anywhere else it is read straight into the arena, still without a buffer in between.
+LoadStatus LoadImage(MemoryArena* arena, const char* path, uint16_t address, size_t* size);
+
+#endif //ARENA8080_H
@@ -0,0 +1,194 @@
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "batch8080.h"
+#include "blocks8080.h"
+#include "jit8080.h"
+#include "snapshot8080.h"
+
+//The jobs dealt to one worker. The owner takes from the front and thieves from the back, so they
+//only meet over the last job left.
+typedef struct JobQueue {
+    std::mutex  lock;
+    std::deque<size_t>  jobs;
+} JobQueue;
+
+typedef struct BatchResult {
+    RunResult   run;
+    uint16_t    pc;
+    uint8_t     halted;
+    std::vector<uint8_t>    output;
+    bool        done;
+} BatchResult;
+
+typedef struct Batch {
+    const ArenaImage    *image;
+    uint16_t    pc;
+    const std::vector<BatchJob>     *jobs;
+    std::unique_ptr<JobQueue[]>     queues;
+    unsigned    workers;
+    std::vector<BatchResult>        results;
+    std::mutex  output_lock;    //guards out, printed and the done flags
+    size_t      printed;        //jobs written to out, always a prefix of the manifest
+    std::ostream    *out;
+} Batch;
+
+//What the port handlers of a running job work on, through State8080::devices.
+typedef struct JobPorts {
+    const BatchJob  *job;
+    size_t      next;   //the next input byte
+    std::vector<uint8_t>    output;
+} JobPorts;
+
+static uint8_t BatchIn(State8080* state, uint8_t) {
+    JobPorts* ports = static_cast<JobPorts*>(state->devices);
+    return ports->next < ports->job->input.size() ? ports->job->input[ports->next++] : 0;
+}
+
+static void BatchOut(State8080* state, uint8_t, const uint8_t value) {
+    static_cast<JobPorts*>(state->devices)->output.push_back(value);
+}
+
+static int HexDigit(const char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool ReadBatchManifest(std::istream& in, std::vector<BatchJob>* jobs, size_t* line) {
+    std::string text;
+    for (*line = 1; std::getline(in, text); (*line)++) {
+        std::istringstream fields(text);
+        BatchJob job = {};
+        std::string input;
+        if (!(fields >> job.name) || job.name[0] == '#')
+            continue;
+        //Reading into an unsigned count would quietly wrap a negative one into a huge budget.
+        fields >> std::ws;
+        if (fields.peek() == '-' || !(fields >> job.cycles))
+            return false;
+        fields >> input;
+        std::string rest;
+        if (fields >> rest || input.size() % 2 != 0)
+            return false;
+
+        for (size_t i = 0; i < input.size(); i += 2) {
+            const int high = HexDigit(input[i]);
+            const int low = HexDigit(input[i + 1]);
+            if (high < 0 || low < 0)
+                return false;
+            job.input.push_back(static_cast<uint8_t>(high << 4 | low));
+        }
+        jobs->push_back(std::move(job));
+    }
+    return true;
+}
+
+//Takes the next job of worker, or steals the last one of the first other worker that still has any.
+static bool NextJob(Batch* batch, const unsigned worker, size_t* index) {
+    for (unsigned step = 0; step < batch->workers; step++) {
+        JobQueue& queue = batch->queues[(worker + step) % batch->workers];
+        std::lock_guard<std::mutex> hold(queue.lock);
+        if (queue.jobs.empty())
+            continue;
+        if (step == 0) {
+            *index = queue.jobs.front();
+            queue.jobs.pop_front();
+        } else {
+            *index = queue.jobs.back();
+            queue.jobs.pop_back();
+        }
+        return true;
+    }
+    return false;
+}
+
+//Marks a job done and writes out every finished job that no earlier job is still holding back.
+static void Report(Batch* batch, const size_t index) {
+    std::lock_guard<std::mutex> hold(batch->output_lock);
+    batch->results[index].done = true;
+    for (; batch->printed < batch->results.size() && batch->results[batch->printed].done; batch->printed++) {
+        const BatchJob& job = (*batch->jobs)[batch->printed];
+        BatchResult& result = batch->results[batch->printed];
+        std::ostream& out = *batch->out;
+        out << job.name << std::dec << " cycles " << result.run.cycles << " instructions "
+            << result.run.instructions << std::hex << std::setfill('0') << " pc " << std::setw(4) << result.pc
+            << (result.halted ? " halted" : "") << " output ";
+        for (const uint8_t byte : result.output)
+            out << std::setw(2) << +byte;
+        out << std::dec << "\n";
+        result.output = std::vector<uint8_t>();
+    }
+}
+
+static void RunWorker(Batch* batch, const unsigned worker) {
+    std::unique_ptr<MemoryArena, void (*)(MemoryArena*)> arena(CloneArena(batch->image), DestroyArena);
+    if (!arena)
+        return;
+    std::unique_ptr<JitCache, void (*)(JitCache*)> jit(CreateJitCache(), DestroyJitCache);
+    std::unique_ptr<BlockCache> blocks(jit ? nullptr : new BlockCache());
+
+    size_t index = 0;
+    while (NextJob(batch, worker, &index)) {
+        const BatchJob& job = (*batch->jobs)[index];
+        JobPorts ports = {&job, 0, {}};
+        State8080 state = {};
+        state.memory = arena->memory;
+        state.pc = batch->pc;
+        state.port_in = BatchIn;
+        state.port_out = BatchOut;
+        state.devices = &ports;
+        state.blocks = jit ? &jit->blocks : blocks.get();
+        state.jit = jit.get();
+
+        BatchResult& result = batch->results[index];
+        result.run = Run8080(&state, job.cycles);
+        result.pc = state.pc;
+        result.halted = state.halted;
+        result.output = std::move(ports.output);
+        //Only what this job changed is put back, and code cached over it is dropped with it.
+        RestoreDirtyPages(&state, batch->image->memory);
+        Report(batch, index);
+    }
+}
+
+bool RunBatch(const ArenaImage* image, const uint16_t pc, const std::vector<BatchJob>& jobs, unsigned threads,
+              std::ostream& out) {
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads > jobs.size())
+        threads = static_cast<unsigned>(jobs.size());
+    if (threads == 0)
+        return true;
+
+    Batch batch = {};
+    batch.image = image;
+    batch.pc = pc;
+    batch.jobs = &jobs;
+    batch.queues.reset(new JobQueue[threads]);
+    batch.workers = threads;
+    batch.results.resize(jobs.size());
+    batch.out = &out;
+    for (unsigned worker = 0; worker < threads; worker++) {
+        for (size_t index = jobs.size() * worker / threads; index < jobs.size() * (worker + 1) / threads; index++)
+            batch.queues[worker].jobs.push_back(index);
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned worker = 1; worker < threads; worker++)
+        workers.emplace_back(RunWorker, &batch, worker);
+    RunWorker(&batch, 0);
+    for (std::thread& worker : workers)
+        worker.join();
+    out.flush();
+
+    return batch.printed == jobs.size();
+}
@@ -0,0 +1,37 @@
+#ifndef BATCH8080_H
+#define BATCH8080_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "arena8080.h"
+#include "cpu8080.h"
+
+//One run of the shared image. IN returns the input bytes in order, whatever the port, and 0 once they
+//are used up; OUT bytes are collected, whatever the port, and reported with the result.
+typedef struct BatchJob {
+    std::string     name;
+    uint64_t        cycles;
+    std::vector<uint8_t>    input;
+} BatchJob;
+
+//Reads a job manifest: one job per line as "name cycles [input]", the input written as hex bytes, e.g.
+//"run7 2000000 0d0a41". Blank lines and lines starting with # are skipped. The inputs are part of the
+//manifest so that running a job never opens a file. On a malformed line returns false with line set
+//to its number.
+bool ReadBatchManifest(std::istream& in, std::vector<BatchJob>* jobs, size_t* line);
+
+//Runs every job on its own machine, each starting at pc with the memory of image, on threads workers
+//(0 for one per host core). Each worker maps one copy-on-write clone of image and keeps it, and its
+//translated code, from job to job, putting back only the pages the last job dirtied. Jobs are dealt
+//out in even runs and a worker that runs out steals from the back of another's. One line per job goes
+//to out, in manifest order, as soon as the job and all before it are done. Returns false when a
+//worker cannot get its memory.
+bool RunBatch(const ArenaImage* image, uint16_t pc, const std::vector<BatchJob>& jobs, unsigned threads,
+              std::ostream& out);
+
+#endif //BATCH8080_H
@@ -0,0 +1,157 @@
+#include <algorithm>
+
+#include "blocks8080.h"
+#include "jit8080.h"
+#include "ops8080.h"
+
+void InvalidateBlocks(BlockCache* cache, const uint16_t address) {
+    for (int back = 0; back < MAX_BLOCK_BYTES; back++) {
+        const uint16_t start = address - back;
+        std::unique_ptr<CodeBlock>& block = cache->blocks[start];
+        if (!block || block->length <= back)
+            continue;
+
+        for (int i = 0; i < block->length; i++)
+            cache->cover[static_cast<uint16_t>(start + i)]--;
+        block->valid = false;
+        if (block->native != nullptr)
+            UnlinkJitBlock(cache->jit, start);
+        //The block may be the one running, so it is only freed once RunBlocks is between blocks.
+        cache->retired.push_back(std::move(block));
+        cache->invalidations++;
+    }
+}
+
+static CodeBlock* Compile(BlockCache* cache, const State8080* state, const uint16_t start) {
+    std::unique_ptr<CodeBlock> block(new CodeBlock());
+    block->start = start;
+    block->valid = true;
+
+    //Ops before the first one where an existing block starts, or 0 if none does.
+    size_t joined = 0;
+    uint16_t address = start;
+    for (;;) {
+        const DecodedOp op = Decode(state, address);
+        block->ops.push_back(op);
+        address += op.length;
+        if (EndsBlock(op.opcode) || block->ops.size() == MAX_BLOCK_OPS)
+            break;
+        if (joined == 0 && cache->blocks[address])
+            joined = block->ops.size();
+    }
+    //Unless the whole block is a loop RunIdleLoop can fast-forward, it ends where it runs into a block
+    //that is already there. A run that stopped in the middle of a block, e.g. at its budget, then
+    //joins the blocks after it instead of compiling a second chain shifted against them.
+    block->loop = ClassifyLoop(block->ops, start);
+    if (block->loop == LOOP_NONE && joined != 0) {
+        block->ops.resize(joined);
+        address = start;
+        for (const DecodedOp& op : block->ops)
+            address += op.length;
+    }
+    for (size_t i = 0; i + 1 < block->ops.size(); i++)
+        block->lead_cycles += block->ops[i].cycles;
+
+    block->length = static_cast<uint16_t>(address - start);
+    for (int i = 0; i < block->length; i++)
+        cache->cover[static_cast<uint16_t>(start + i)]++;
+    cache->compiled++;
+
+    cache->blocks[start] = std::move(block);
+    return cache->blocks[start].get();
+}
+
+CodeBlock* FindBlock(BlockCache* cache, const State8080* state, const uint16_t start) {
+    CodeBlock* block = cache->blocks[start].get();
+    return block != nullptr ? block : Compile(cache, state, start);
+}
+
+#if THREADED_DISPATCH
+#define OPCODE(n)                                                       \
+    op_##n:                                                             \
+        state->pc += length8080[n];                                     \
+        result.cycles += Execute<n, DefaultFlags>(state, op->operand);  \
+        result.instructions++;                                          \
+        if ((StoresToMemory(n) && !block->valid) || ++op == end ||      \
+            (BUDGETED && result.cycles >= cycle_budget))                \
+            return;                                                     \
+        goto *dispatch_table[op->opcode];
+#else
+#define OPCODE(n)                                                       \
+    case n:                                                             \
+        state->pc += length8080[n];                                     \
+        result.cycles += Execute<n, DefaultFlags>(state, op->operand);  \
+        result.instructions++;                                          \
+        if (StoresToMemory(n) && !block->valid)                         \
+            return;                                                     \
+        break;
+#endif
+
+//Runs the ops of block in order. With BUDGETED set it stops as soon as the budget is reached, as
+//RunCore does. Either way it stops after a store that invalidated the block, whose remaining ops
+//may no longer match memory.
+template <bool BUDGETED>
+static void RunBlock(State8080* state, const CodeBlock* block, RunResult& result, const uint64_t cycle_budget) {
+    const DecodedOp* op = block->ops.data();
+    const DecodedOp* const end = op + block->ops.size();
+
+#if THREADED_DISPATCH
+    static const void* const dispatch_table[256] = {OPCODE_LIST(OPCODE_ADDRESS)};
+
+    goto *dispatch_table[op->opcode];
+    OPCODE_LIST(OPCODE)
+#else
+    for (; op != end; op++) {
+        switch (op->opcode) {
+            OPCODE_LIST(OPCODE)
+        }
+        if (BUDGETED && result.cycles >= cycle_budget)
+            return;
+    }
+#endif
+}
+
+void RunCodeBlock(State8080* state, const CodeBlock* block, RunResult& result, const uint64_t cycle_budget) {
+    //Only the last instruction can take more than its listed cycles, so if the others cannot reach
+    //the budget the whole block runs without checking it.
+    if (result.cycles + block->lead_cycles < cycle_budget)
+        RunBlock<false>(state, block, result, cycle_budget);
+    else
+        RunBlock<true>(state, block, result, cycle_budget);
+}
+
+RunResult RunBlocks(State8080* state, const uint64_t cycle_budget) {
+    BlockCache* cache = state->blocks;
+    RunResult result = {0, 0};
+
+    while (result.cycles < cycle_budget && !state->halted) {
+        if (!cache->retired.empty())
+            cache->retired.clear();
+
+        CodeBlock* block = FindBlock(cache, state, state->pc);
+        block->executions++;
+        if (block->loop != LOOP_NONE)
+            RunIdleLoop(state, block, result, cycle_budget);
+        else
+            RunCodeBlock(state, block, result, cycle_budget);
+    }
+    cache->retired.clear();
+
+    return result;
+}
+
+std::vector<const CodeBlock*> HotBlocks(const BlockCache* cache, const size_t count) {
+    std::vector<const CodeBlock*> hot;
+    for (const std::unique_ptr<CodeBlock>& block : cache->blocks) {
+        if (block)
+            hot.push_back(block.get());
+    }
+
+    const size_t n = std::min(count, hot.size());
+    std::partial_sort(hot.begin(), hot.begin() + n, hot.end(), [](const CodeBlock* x, const CodeBlock* y) {
+        return x->executions > y->executions;
+    });
+    hot.resize(n);
+
+    return hot;
+}
@@ -0,0 +1,84 @@
+#ifndef BLOCKS8080_H
+#define BLOCKS8080_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpu8080.h"
+#include "idle8080.h"
+#include "predecode8080.h"
+
+//Longest block, in instructions. Caps how far back a store has to look for blocks that cover it.
+constexpr int MAX_BLOCK_OPS = 64;
+constexpr int MAX_BLOCK_BYTES = MAX_BLOCK_OPS * 3;
+
+//Instructions after which the next pc, or whether an interrupt may be taken, is not known until
+//they run.
+constexpr bool EndsBlock(const int op) {
+    return (op & 0xc7) == 0xc0 ||                       //Rcc
+           (op & 0xc7) == 0xc2 ||                       //Jcc
+           (op & 0xc7) == 0xc4 ||                       //Ccc
+           (op & 0xc7) == 0xc7 ||                       //RST
+           op == 0xc3 || op == 0xcb ||                  //JMP
+           op == 0xc9 || op == 0xd9 ||                  //RET
+           (op & 0xcf) == 0xcd ||                       //CALL
+           op == 0xe9 || op == 0x76 ||                  //PCHL, HLT
+           op == 0xf3 || op == 0xfb;                    //DI, EI
+}
+
+//Instructions that can store into memory, and with that into the block that is running. IN and OUT
+//count because their port handlers can store anywhere.
+constexpr bool StoresToMemory(const int op) {
+    return op == 0x02 || op == 0x12 || op == 0x22 || op == 0x32 ||   //STAX, SHLD, STA
+           op == 0x34 || op == 0x35 || op == 0x36 ||                  //INR M, DCR M, MVI M
+           (op & 0xf8) == 0x70 ||                                     //MOV M,r and HLT
+           (op & 0xcb) == 0xc1 || op == 0xe3 ||                       //PUSH, POP (harmless), XTHL
+           (op & 0xc7) == 0xc4 || (op & 0xcf) == 0xcd || (op & 0xc7) == 0xc7 ||  //Ccc, CALL, RST
+           op == 0xd3 || op == 0xdb;                                  //OUT, IN
+}
+
+//A straight run of instructions that ends at the first jump, call, return, RST, PCHL, HLT, EI or DI.
+//Only the last instruction can change the flow of control or take extra cycles.
+typedef struct CodeBlock {
+    uint16_t    start;
+    uint16_t    length;         //bytes covered, starting at start
+    uint32_t    lead_cycles;    //cycles of every instruction but the last
+    bool        valid;          //cleared when a store hits the block, possibly while it is running
+    LoopKind    loop;           //an idle loop RunIdleLoop can fast-forward, or LOOP_NONE
+    uint64_t    executions;     //dispatches, not counting entries through chained translated code
+    const uint8_t   *native;    //translated code when a JitCache owns the block, otherwise nullptr
+    std::vector<DecodedOp>  ops;
+} CodeBlock;
+
+//Blocks indexed by their start address. A byte may belong to several blocks when code jumps into
+//the middle of another block, so cover counts them like PredecodeCache::cover does.
+typedef struct BlockCache {
+    std::array<std::unique_ptr<CodeBlock>, 0x10000> blocks;
+    std::array<uint8_t, 0x10000>    cover;
+    std::vector<std::unique_ptr<CodeBlock>> retired;    //invalidated blocks, freed between blocks
+    struct      JitCache    *jit;   //the JitCache this cache belongs to, if any
+    uint64_t    compiled;
+    uint64_t    invalidations;
+} BlockCache;
+
+//Drops every block that includes address. Write8 calls this for stores into cached code.
+void InvalidateBlocks(BlockCache* cache, uint16_t address);
+
+//Returns the block that starts at start, building it on a miss.
+CodeBlock* FindBlock(BlockCache* cache, const State8080* state, uint16_t start);
+
+//Runs one block, adding to result. Stops early at the budget or after a store into the block.
+void RunCodeBlock(State8080* state, const CodeBlock* block, RunResult& result, uint64_t cycle_budget);
+
+//Run8080 on a state with a block cache attached. Looks up, and on a miss builds, the block at pc and
+//runs all of it per dispatch. Budget and halt checks happen between blocks; a block that would cross
+//the budget runs instruction by instruction so the run stops exactly where RunCore would. Idle loops
+//are fast-forwarded by RunIdleLoop. Leaves lazy flags pending on return.
+RunResult RunBlocks(State8080* state, uint64_t cycle_budget);
+
+//The count most executed blocks in the cache, hottest first.
+std::vector<const CodeBlock*> HotBlocks(const BlockCache* cache, size_t count);
+
+#endif //BLOCKS8080_H
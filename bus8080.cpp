@@ -0,0 +1,163 @@
+#include <cstdint>
+
+#include "bus8080.h"
+#include "ops8080.h"
+
+//Links every page whose memory is also mapped at another page into a ring through mirror. Pages are
+//compared by the host memory they read, or write when they have no read pointer.
+static void LinkMirrors(MemoryBus* bus) {
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        const uint8_t* host = bus->host_read[page] != nullptr ? bus->host_read[page] : bus->host_write[page];
+        bus->mirror[page] = page;
+        if (host == nullptr)
+            continue;
+
+        for (int step = 1; step < PAGE_COUNT; step++) {
+            const int other = (page + step) % PAGE_COUNT;
+            if (bus->host_read[other] == host || bus->host_write[other] == host) {
+                bus->mirror[page] = other;
+                break;
+            }
+        }
+    }
+}
+
+//Points the fast path of page at its host memory, unless an address in it is watched.
+static void RefreshPage(MemoryBus* bus, const int page) {
+    const Watchpoints* watch = bus->watch;
+    bus->read[page] = watch != nullptr && watch->reads[page] != 0 ? nullptr : bus->host_read[page];
+    bus->write[page] = watch != nullptr && watch->writes[page] != 0 ? nullptr : bus->host_write[page];
+}
+
+static void MapPages(MemoryBus* bus, const uint16_t address, const uint32_t size, const uint8_t* read,
+                     uint8_t* write, const PageHandler handler) {
+    for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+        const int page = ((address + offset) >> 8) & 0xff;
+        bus->host_read[page] = read != nullptr ? read + offset : nullptr;
+        bus->host_write[page] = write != nullptr ? write + offset : nullptr;
+        bus->handlers[page] = handler;
+        RefreshPage(bus, page);
+    }
+    LinkMirrors(bus);
+}
+
+void MapRam(MemoryBus* bus, const uint16_t address, const uint32_t size, uint8_t* host) {
+    MapPages(bus, address, size, host, host, {nullptr, nullptr});
+}
+
+void MapRom(MemoryBus* bus, const uint16_t address, const uint32_t size, const uint8_t* host) {
+    MapPages(bus, address, size, host, nullptr, {nullptr, nullptr});
+}
+
+void MapDevice(MemoryBus* bus, const uint16_t address, const uint32_t size, const PageHandler handler) {
+    MapPages(bus, address, size, nullptr, nullptr, handler);
+}
+
+bool Watch(MemoryBus* bus, Watchpoints* watch, const uint16_t address, const uint8_t kinds) {
+    if (bus->watch == nullptr)
+        bus->watch = watch;
+    if (bus->watch != watch)
+        return false;
+
+    const uint8_t added = kinds & ~watch->kinds[address];
+    watch->kinds[address] |= added;
+    watch->reads[address >> 8] += (added & WATCH_READ) != 0;
+    watch->writes[address >> 8] += (added & WATCH_WRITE) != 0;
+    RefreshPage(bus, address >> 8);
+    return true;
+}
+
+void Unwatch(MemoryBus* bus, const uint16_t address) {
+    Watchpoints* watch = bus->watch;
+    if (watch == nullptr)
+        return;
+
+    const uint8_t removed = watch->kinds[address];
+    watch->kinds[address] = 0;
+    watch->reads[address >> 8] -= (removed & WATCH_READ) != 0;
+    watch->writes[address >> 8] -= (removed & WATCH_WRITE) != 0;
+    RefreshPage(bus, address >> 8);
+}
+
+static void Hit(const State8080* state, const uint16_t address, const uint8_t value, const WatchKind kind) {
+    Watchpoints* watch = state->bus->watch;
+    if (watch == nullptr || (watch->kinds[address] & kind) == 0)
+        return;
+
+    const WatchHit hit = {address, state->pc, value, kind};
+    watch->hits.push_back(hit);
+    if (watch->on_hit != nullptr)
+        watch->on_hit(state, hit);
+}
+
+uint8_t ReadHandler(const State8080* state, const uint16_t address) {
+    MemoryBus* bus = state->bus;
+    bus->handler_reads++;
+    const uint8_t* host = bus->host_read[address >> 8];
+    if (host != nullptr) {
+        const uint8_t value = host[address & 0xff];
+        Hit(state, address, value, WATCH_READ);
+        return value;
+    }
+
+    const PageHandler& handler = bus->handlers[address >> 8];
+    const uint8_t value = handler.read != nullptr ? handler.read(state, address) : 0xff;
+    Hit(state, address, value, WATCH_READ);
+    return value;
+}
+
+void WriteHandler(State8080* state, const uint16_t address, const uint8_t value) {
+    MemoryBus* bus = state->bus;
+    Hit(state, address, value, WATCH_WRITE);
+    //A watched page of host memory takes the rest of the path Write8 would have.
+    uint8_t* host = bus->host_write[address >> 8];
+    if (host != nullptr) {
+        host[address & 0xff] = value;
+        state->dirty[address >> 8] = 1;
+        if (bus->mirror[address >> 8] != address >> 8)
+            InvalidateMirrors(state, address);
+        InvalidateStore(state, address);
+        return;
+    }
+
+    const PageHandler& handler = bus->handlers[address >> 8];
+    if (handler.write != nullptr)
+        handler.write(state, address, value);
+}
+
+void InvalidateMirrors(State8080* state, const uint16_t address) {
+    const MemoryBus* bus = state->bus;
+    for (int page = bus->mirror[address >> 8]; page != address >> 8; page = bus->mirror[page])
+        InvalidateStore(state, static_cast<uint16_t>(page << 8 | (address & 0xff)));
+}
+
+const uint8_t* HostSource(const State8080* state, const uint16_t address, const uint32_t count) {
+    if (state->memory != nullptr)
+        return state->memory + address;
+
+    const uint8_t* host = state->bus->read[address >> 8];
+    if (host == nullptr)
+        return nullptr;
+    host += address & 0xff;
+    //Each page after the first has to continue where the one before it ended.
+    for (uint32_t offset = PAGE_SIZE - (address & 0xff); offset < count; offset += PAGE_SIZE) {
+        if (state->bus->read[((address + offset) >> 8) & 0xff] != host + offset)
+            return nullptr;
+    }
+    return host;
+}
+
+uint8_t* HostDestination(State8080* state, const uint16_t address, const uint32_t count) {
+    if (state->memory != nullptr)
+        return state->memory + address;
+
+    uint8_t* host = state->bus->write[address >> 8];
+    if (host == nullptr)
+        return nullptr;
+    host += address & 0xff;
+    for (uint32_t offset = PAGE_SIZE - (address & 0xff); offset < count; offset += PAGE_SIZE) {
+        if (state->bus->write[((address + offset) >> 8) & 0xff] != host + offset)
+            return nullptr;
+    }
+    return host;
+}
@@ -0,0 +1,92 @@
+#ifndef BUS8080_H
+#define BUS8080_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "cpu8080.h"
+
+constexpr int PAGE_SIZE = 0x100;
+constexpr int PAGE_COUNT = 0x100;
+
+//Callbacks for a page that is not host memory. A missing read callback reads 0xff and a missing write
+//callback drops the byte.
+typedef struct PageHandler {
+    uint8_t     (*read)(const State8080* state, uint16_t address);
+    void        (*write)(State8080* state, uint16_t address, uint8_t value);
+} PageHandler;
+
+enum WatchKind : uint8_t {
+    WATCH_READ = 1,
+    WATCH_WRITE = 2,
+};
+
+//One access to a watched address.
+typedef struct WatchHit {
+    uint16_t    address;
+    uint16_t    pc;         //state->pc at the access, past the instruction that made it
+    uint8_t     value;      //read, or stored (also when ROM dropped it)
+    uint8_t     kind;       //WATCH_READ or WATCH_WRITE
+} WatchHit;
+
+//Read and write watchpoints on guest addresses. Only the pages that hold a watched address leave the
+//fast path of Read8/Write8, by clearing their read or write pointer so that the access goes to
+//ReadHandler or WriteHandler, which check the address and then do what the page maps. Every other
+//page, and every bus without watchpoints, runs exactly as before. Instruction fetches are reads too,
+//so a watched code byte hits each time the interpreter fetches it but only when the caching engines
+//decode it.
+typedef struct Watchpoints {
+    std::array<uint8_t, 0x10000>            kinds;      //WatchKind bits of each address
+    std::array<uint16_t, PAGE_COUNT>        reads;      //addresses watched for reads in each page
+    std::array<uint16_t, PAGE_COUNT>        writes;
+    std::vector<WatchHit>   hits;       //every hit, in order, until the caller clears it
+    void        (*on_hit)(const State8080* state, const WatchHit& hit);    //called on each hit when set
+} Watchpoints;
+
+//The 64K address space as 256 pages of 256 bytes. A page with a read or write pointer is host memory
+//and Read8/Write8 index it directly; one without goes to its handler. The bus is only used while
+//State8080::memory is null. ROM is a page with a read pointer and no write pointer or write callback,
+//so stores to it are dropped. Mapping the same host memory at several pages mirrors it, and mirror
+//links those pages in a ring so a store through one also invalidates code cached at the others. The
+//predecoded, block and compiled engines decode code once and only drop it when a store to host
+//memory changes it, so they expect code to run from host memory, never from a device page.
+typedef struct MemoryBus {
+    std::array<const uint8_t*, PAGE_COUNT>  read;       //host_read, unless a read in the page is watched
+    std::array<uint8_t*, PAGE_COUNT>        write;      //host_write, unless a write in the page is watched
+    std::array<const uint8_t*, PAGE_COUNT>  host_read;  //what each page maps
+    std::array<uint8_t*, PAGE_COUNT>        host_write;
+    std::array<PageHandler, PAGE_COUNT>     handlers;
+    std::array<uint8_t, PAGE_COUNT>         mirror;     //the next page on the same host memory, itself if none
+    uint64_t    handler_reads;  //reads that went to a handler, which idle loop detection has to see
+    struct      Watchpoints     *watch;     //set by Watch, owned by the caller
+} MemoryBus;
+
+//Map size bytes from address on, both multiples of PAGE_SIZE. host points at the first byte.
+void MapRam(MemoryBus* bus, uint16_t address, uint32_t size, uint8_t* host);
+void MapRom(MemoryBus* bus, uint16_t address, uint32_t size, const uint8_t* host);
+void MapDevice(MemoryBus* bus, uint16_t address, uint32_t size, PageHandler handler);
+
+//Adds the WatchKind bits in kinds to the watchpoint at address, attaching watch to bus if it is not
+//attached yet. Mapping pages afterwards keeps their watchpoints. Returns false, changing nothing, when
+//a different Watchpoints is already attached.
+bool Watch(MemoryBus* bus, Watchpoints* watch, uint16_t address, uint8_t kinds);
+//Removes the watchpoint at address. A page left without any returns to the fast path.
+void Unwatch(MemoryBus* bus, uint16_t address);
+
+//The paths of Read8 and Write8 for pages without host memory, or with a watched address.
+uint8_t ReadHandler(const State8080* state, uint16_t address);
+void WriteHandler(State8080* state, uint16_t address, uint8_t value);
+
+//Invalidates code cached at every other page of the mirror ring of address. Write8 calls this for
+//stores through a mirrored page.
+void InvalidateMirrors(State8080* state, uint16_t address);
+
+//Host memory holding count bytes from address on, for bulk copies, or nullptr unless every page is
+//direct and the pages follow each other in host memory. With flat memory this is state->memory +
+//address. Mirrored pages are returned too, and a store through them changes every mirror, so before
+//writing the caller has to check the mirrors for cached code as well, as RunIdleLoop does.
+const uint8_t* HostSource(const State8080* state, uint16_t address, uint32_t count);
+uint8_t* HostDestination(State8080* state, uint16_t address, uint32_t count);
+
+#endif //BUS8080_H
@@ -0,0 +1,89 @@
+#include "cpu8080.h"
+#include "aot8080.h"
+#include "blocks8080.h"
+#include "jit8080.h"
+#include "ops8080.h"
+#include "predecode8080.h"
+
+#if THREADED_DISPATCH
+//Runs the handler, then jumps straight to the handler of the next instruction.
+#define OPCODE(n)                                                       \
+    op_##n:                                                             \
+        result.cycles += Step<n, Flags>(state);                         \
+        result.instructions++;                                          \
+        if (result.cycles >= cycle_budget || state->halted)             \
+            return result;                                              \
+        goto *dispatch_table[Read8(state, state->pc)];
+#else
+#define OPCODE(n)                                                       \
+    case n:                                                             \
+        result.cycles += Step<n, Flags>(state);                         \
+        break;
+#endif
+
+template <typename Flags>
+RunResult RunCore(State8080* state, const uint64_t cycle_budget) {
+    RunResult result = {0, 0};
+
+#if THREADED_DISPATCH
+    static const void* const dispatch_table[256] = {OPCODE_LIST(OPCODE_ADDRESS)};
+
+    if (result.cycles >= cycle_budget || state->halted)
+        return result;
+    goto *dispatch_table[Read8(state, state->pc)];
+    OPCODE_LIST(OPCODE)
+#else
+    while (result.cycles < cycle_budget && !state->halted) {
+        switch (Read8(state, state->pc)) {
+            OPCODE_LIST(OPCODE)
+        }
+        result.instructions++;
+    }
+
+    return result;
+#endif
+}
+
+template RunResult RunCore<EagerFlags>(State8080* state, uint64_t cycle_budget);
+template RunResult RunCore<LazyFlags>(State8080* state, uint64_t cycle_budget);
+
+RunResult Run8080(State8080* state, const uint64_t cycle_budget) {
+    RunResult result;
+    if (state->jit != nullptr)
+        result = RunJit(state, cycle_budget);
+    else if (state->aot != nullptr)
+        result = RunAot(state, cycle_budget);
+    else if (state->blocks != nullptr)
+        result = RunBlocks(state, cycle_budget);
+    else if (state->predecode != nullptr)
+        result = RunPredecoded(state, cycle_budget);
+    else
+        result = RunCore<DefaultFlags>(state, cycle_budget);
+    DefaultFlags::Settle(state);
+
+    //Nothing but an interrupt ends HLT, and none can arrive before the caller gets control back.
+    if (state->halted && result.cycles < cycle_budget)
+        result.cycles = cycle_budget;
+    return result;
+}
+
+int Interrupt8080(State8080* state, const int vector) {
+    if (!state->int_enable)
+        return 0;
+
+    state->int_enable = 0;
+    state->halted = 0;
+    Push16(state, state->pc);
+    state->pc = (vector & 7) << 3;
+    return cycles8080[0xc7];
+}
+
+int Emulate8080Op(State8080* state) {
+    if (state->halted)
+        return cycles8080[0x76];
+    if (state->predecode != nullptr || state->blocks != nullptr || state->jit != nullptr ||
+        state->aot != nullptr)
+        return static_cast<int>(Run8080(state, 1).cycles);
+
+    return step_table<EagerFlags>[Read8(state, state->pc)](state);
+}
@@ -0,0 +1,261 @@
+#ifndef CPU8080_H
+#define CPU8080_H
+
+#include <array>
+#include <cstdint>
+
+//Flag bits as they sit in the 8080 PSW byte: S Z 0 AC 0 P 1 CY.
+constexpr uint8_t FLAG_S  = 0x80;   //(sign) set to 1 when bit 7 (the most significant bit or MSB) of the math instruction is set
+constexpr uint8_t FLAG_Z  = 0x40;   //(zero) set to 1 when the result is equal to zero
+constexpr uint8_t FLAG_AC = 0x10;   //(auxillary carry) is used mostly for BCD (binary coded decimal) math
+constexpr uint8_t FLAG_P  = 0x04;   //(parity) is set when the answer has even parity, clear when odd parity
+constexpr uint8_t FLAG_CY = 0x01;   //(carry) set to 1 when the instruction resulted in a carry out or borrow into the high order bit
+constexpr uint8_t PSW_FIXED = 0x02; //bit 1 always reads as 1, bits 3 and 5 as 0
+constexpr uint8_t PSW_FLAGS = FLAG_S | FLAG_Z | FLAG_AC | FLAG_P | FLAG_CY;
+
+//The flags are kept packed in PSW layout, so PUSH PSW and POP PSW move them as one byte and an
+//instruction updates all the flags it affects with a single masked write.
+typedef struct ConditionCodes {
+    uint8_t     psw;
+
+    uint8_t z() const { return (psw >> 6) & 1; }
+    uint8_t s() const { return psw >> 7; }
+    uint8_t p() const { return (psw >> 2) & 1; }
+    uint8_t cy() const { return psw & FLAG_CY; }
+    uint8_t ac() const { return (psw >> 4) & 1; }
+    void set_cy(const bool carry) { psw = (psw & ~FLAG_CY) | (carry ? FLAG_CY : 0); }
+} ConditionCodes;
+
+//Operations whose flags the lazy engine can leave unevaluated.
+enum FlagOp : uint8_t {
+    FLAGOP_NONE,    //cc is up to date
+    FLAGOP_ADD,
+    FLAGOP_SUB,
+    FLAGOP_INC,
+    FLAGOP_DEC,
+    FLAGOP_AND,
+    FLAGOP_LOGIC,   //XRA, ORA and their immediate forms
+};
+
+//The last flag-setting operation, kept instead of the flags it produced until something reads them.
+typedef struct PendingFlags {
+    uint8_t     op;
+    uint8_t     a;
+    uint8_t     b;
+    uint16_t    answer;
+} PendingFlags;
+
+//Lays out a register pair so that the pair is one 16-bit value and each half is still its own byte.
+//The high register has to sit in the high byte of the pair, which depends on the host byte order.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define REGISTER_PAIR(hi, lo) union { struct { uint8_t hi, lo; }; uint16_t hi##lo; }
+#else
+#define REGISTER_PAIR(hi, lo) union { struct { uint8_t lo, hi; }; uint16_t hi##lo; }
+#endif
+
+struct PredecodeCache;
+struct BlockCache;
+struct JitCache;
+struct AotProgram;
+struct MemoryBus;
+
+typedef struct State8080 {
+    uint8_t     a;
+    REGISTER_PAIR(b, c);
+    REGISTER_PAIR(d, e);
+    REGISTER_PAIR(h, l);
+    uint16_t    sp;
+    uint16_t    pc;
+    uint8_t     *memory;    //flat 64K; leave it null to go through bus instead
+    struct      MemoryBus       *bus;       //the page map used when memory is null
+    uint8_t     (*port_in)(struct State8080* state, uint8_t port);                  //IN reads 0 when unset
+    void        (*port_out)(struct State8080* state, uint8_t port, uint8_t value);  //OUT is ignored when unset
+    void        *devices;   //owned by whoever installed the port handlers
+    struct      ConditionCodes  cc;
+    struct      PendingFlags    pending;    //only used by the lazy flag engine inside Run8080
+    uint8_t     int_enable;
+    uint8_t     halted;     //set by HLT, cleared by Interrupt8080
+    struct      PredecodeCache  *predecode; //when set, Run8080 executes decoded instructions from it
+    struct      BlockCache      *blocks;    //when set, Run8080 executes whole cached blocks from it
+    struct      JitCache        *jit;       //when set, Run8080 runs translated blocks; blocks must be its cache
+    struct      AotProgram      *aot;       //when set, Run8080 runs blocks compiled ahead of time from it
+    std::array<uint8_t, 256>    dirty;      //non-zero for each 256-byte page stored to since ClearDirtyPages
+} State8080;
+
+typedef struct RunResult {
+    uint64_t    cycles;         //clock cycles executed, the last instruction may overshoot the budget
+    uint64_t    instructions;   //instructions executed
+} RunResult;
+
+constexpr bool parity(const int val) {
+    uint8_t one_bits = 0;
+    for (int i = 0; i < 8; i++) {
+        one_bits += ((val >> i) & 1);
+    }
+
+    return (one_bits & 1) == 0;
+}
+
+constexpr std::array<uint8_t, 256> MakeZSPTable() {
+    std::array<uint8_t, 256> table = {};
+    for (int i = 0; i < 256; i++) {
+        table[i] = (i == 0 ? FLAG_Z : 0) | (i & 0x80 ? FLAG_S : 0) | (parity(i) ? FLAG_P : 0);
+    }
+
+    return table;
+}
+
+//Zero, sign and parity flags for every possible 8-bit result, built at compile time.
+inline constexpr std::array<uint8_t, 256> zsp_table = MakeZSPTable();
+
+//The auxiliary carry is the carry out of bit 3. Bit 4 of a ^ b ^ result is the carry that went into it,
+//and it already sits where FLAG_AC lives. The 8080 subtracts by adding the complement, so for
+//subtraction the carry is inverted.
+inline uint8_t AuxCarryAdd(const uint8_t a, const uint8_t b, const uint16_t answer) {
+    return (a ^ b ^ answer) & FLAG_AC;
+}
+
+inline uint8_t AuxCarrySub(const uint8_t a, const uint8_t b, const uint16_t answer) {
+    return ~(a ^ b ^ answer) & FLAG_AC;
+}
+
+//ADD, ADC, ADI, ACI. answer is the untruncated sum, including any carry in, so bit 8 is the carry.
+inline void FlagsAdd(State8080* state, const uint8_t a, const uint8_t b, const uint16_t answer) {
+    state->cc.psw = zsp_table[answer & 0xff] | ((answer >> 8) & FLAG_CY) | AuxCarryAdd(a, b, answer) | PSW_FIXED;
+}
+
+//SUB, SBB, SUI, SBI, CMP, CPI. answer is a - b (- borrow) computed in 16 bits, so a borrow sets bit 8.
+inline void FlagsSub(State8080* state, const uint8_t a, const uint8_t b, const uint16_t answer) {
+    state->cc.psw = zsp_table[answer & 0xff] | ((answer >> 8) & FLAG_CY) | AuxCarrySub(a, b, answer) | PSW_FIXED;
+}
+
+//INR leaves the carry alone and carries out of the low nibble only when it wraps to zero.
+inline void FlagsInc(State8080* state, const uint8_t result) {
+    state->cc.psw = (state->cc.psw & FLAG_CY) | zsp_table[result] | ((result & 0x0f) == 0 ? FLAG_AC : 0) | PSW_FIXED;
+}
+
+//DCR adds 0xff, which carries out of the low nibble unless it borrowed.
+inline void FlagsDec(State8080* state, const uint8_t result) {
+    state->cc.psw = (state->cc.psw & FLAG_CY) | zsp_table[result] | ((result & 0x0f) != 0x0f ? FLAG_AC : 0) |
+                    PSW_FIXED;
+}
+
+//ANA, XRA, ORA and the immediate forms always clear the carry.
+inline void FlagsLogic(State8080* state, const uint8_t result, const bool ac) {
+    state->cc.psw = zsp_table[result] | (ac ? FLAG_AC : 0) | PSW_FIXED;
+}
+
+//Flag engines used by RunCore. Both expose the same operations: record the flags of an ALU result,
+//load a whole PSW, read the carry, and Settle/Settled to bring state->cc up to date before it is
+//read or partly written.
+
+//Writes every flag as soon as the instruction produces it.
+struct EagerFlags {
+    static void Add(State8080* state, const uint8_t a, const uint8_t b, const uint16_t answer) {
+        FlagsAdd(state, a, b, answer);
+    }
+    static void Sub(State8080* state, const uint8_t a, const uint8_t b, const uint16_t answer) {
+        FlagsSub(state, a, b, answer);
+    }
+    static void Inc(State8080* state, const uint8_t result) { FlagsInc(state, result); }
+    static void Dec(State8080* state, const uint8_t result) { FlagsDec(state, result); }
+    static void And(State8080* state, const uint8_t a, const uint8_t b, const uint8_t result) {
+        FlagsLogic(state, result, ((a | b) & 0x08) != 0);
+    }
+    static void Logic(State8080* state, const uint8_t result) { FlagsLogic(state, result, 0); }
+    static void Load(State8080* state, const uint8_t psw) { state->cc.psw = psw; }
+    static uint8_t Carry(const State8080* state) { return state->cc.cy(); }
+    static void Settle(State8080*) {}
+    static ConditionCodes& Settled(State8080* state) { return state->cc; }
+};
+
+//Records the operation and its operands and only computes the flags when they are read. Most flag
+//results are overwritten by the next ALU instruction before any jump, call or return looks at them.
+struct LazyFlags {
+    static void Record(State8080* state, const FlagOp op, const uint8_t a, const uint8_t b, const uint16_t answer) {
+        state->pending.op = op;
+        state->pending.a = a;
+        state->pending.b = b;
+        state->pending.answer = answer;
+    }
+    static void Add(State8080* state, const uint8_t a, const uint8_t b, const uint16_t answer) {
+        Record(state, FLAGOP_ADD, a, b, answer);
+    }
+    static void Sub(State8080* state, const uint8_t a, const uint8_t b, const uint16_t answer) {
+        Record(state, FLAGOP_SUB, a, b, answer);
+    }
+    //INR and DCR keep the carry, so the carry of the operation they replace has to be stored first.
+    static void Inc(State8080* state, const uint8_t result) {
+        state->cc.set_cy(Carry(state));
+        Record(state, FLAGOP_INC, 0, 0, result);
+    }
+    static void Dec(State8080* state, const uint8_t result) {
+        state->cc.set_cy(Carry(state));
+        Record(state, FLAGOP_DEC, 0, 0, result);
+    }
+    static void And(State8080* state, const uint8_t a, const uint8_t b, const uint8_t result) {
+        Record(state, FLAGOP_AND, a, b, result);
+    }
+    static void Logic(State8080* state, const uint8_t result) { Record(state, FLAGOP_LOGIC, 0, 0, result); }
+    //POP PSW replaces every flag, so whatever was pending is dropped.
+    static void Load(State8080* state, const uint8_t psw) {
+        state->pending.op = FLAGOP_NONE;
+        state->cc.psw = psw;
+    }
+    static uint8_t Carry(const State8080* state) {
+        switch (state->pending.op) {
+            case FLAGOP_ADD:
+            case FLAGOP_SUB:
+                return state->pending.answer > 0xff;
+            case FLAGOP_AND:
+            case FLAGOP_LOGIC:
+                return 0;
+            default:
+                return state->cc.cy();
+        }
+    }
+    static void Settle(State8080* state) {
+        const PendingFlags& p = state->pending;
+        switch (p.op) {
+            case FLAGOP_ADD: FlagsAdd(state, p.a, p.b, p.answer); break;
+            case FLAGOP_SUB: FlagsSub(state, p.a, p.b, p.answer); break;
+            case FLAGOP_INC: FlagsInc(state, p.answer); break;
+            case FLAGOP_DEC: FlagsDec(state, p.answer); break;
+            case FLAGOP_AND: FlagsLogic(state, p.answer, ((p.a | p.b) & 0x08) != 0); break;
+            case FLAGOP_LOGIC: FlagsLogic(state, p.answer, 0); break;
+            default: return;
+        }
+        state->pending.op = FLAGOP_NONE;
+    }
+    static ConditionCodes& Settled(State8080* state) {
+        Settle(state);
+        return state->cc;
+    }
+};
+
+//The flag engine Run8080 uses, picked at build time.
+#ifdef I8080_LAZY_FLAGS
+typedef LazyFlags DefaultFlags;
+#else
+typedef EagerFlags DefaultFlags;
+#endif
+
+//The interpreter loop, instantiated for EagerFlags and LazyFlags. Leaves lazy flags pending on return.
+template <typename Flags>
+RunResult RunCore(State8080* state, uint64_t cycle_budget);
+
+//Executes instructions until at least cycle_budget cycles have elapsed. A halted CPU idles out the rest
+//of the budget, and the block engines fast-forward through idle loops, so cycles always reaches the
+//budget and a caller can schedule its next event there. The flags in state->cc are always up to date
+//on return, whichever flag engine the build uses.
+RunResult Run8080(State8080* state, uint64_t cycle_budget);
+
+//Takes an interrupt that jams RST vector onto the bus, if interrupts are enabled: disables them,
+//leaves HLT, pushes pc and jumps to vector * 8. Returns the cycles taken, 0 when interrupts are off.
+int Interrupt8080(State8080* state, int vector);
+
+//Executes a single instruction and returns the cycles it took. A halted CPU spends the cycles of another
+//HLT waiting for an interrupt, so a loop over it always advances the clock.
+int Emulate8080Op(State8080* state);
+
+#endif //CPU8080_H
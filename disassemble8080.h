@@ -0,0 +1,7 @@
+#ifndef DISASSEMBLE8080_H
+#define DISASSEMBLE8080_H
+
+//Prints the instruction at codebuffer[pc] and returns its length in bytes. codebuffer holds all 64K.
+int dissasemble8080(unsigned char *codebuffer, int pc);
+
+#endif //DISASSEMBLE8080_H
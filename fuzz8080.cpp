@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "blocks8080.h"
+#include "fuzz8080.h"
+#include "ops8080.h"
+#include "snapshot8080.h"
+
+typedef struct Fuzzer {
+    const ArenaImage    *image;
+    uint16_t    pc;
+    const FuzzConfig    *config;
+    size_t      seeds;          //inputs corpus started with, run as they are before any mutation
+    std::atomic<uint64_t>   started;
+    std::mutex  lock;           //guards corpus and seen
+    std::vector<std::vector<uint8_t>>   *corpus;
+    std::vector<uint8_t>    seen;       //for each map entry, the count buckets of every run so far
+} Fuzzer;
+
+//What IN reads from, through State8080::devices, when the input goes through the ports.
+typedef struct FuzzPorts {
+    const std::vector<uint8_t>  *input;
+    size_t      next;
+} FuzzPorts;
+
+static uint8_t FuzzIn(State8080* state, uint8_t) {
+    FuzzPorts* ports = static_cast<FuzzPorts*>(state->devices);
+    return ports->next < ports->input->size() ? (*ports->input)[ports->next++] : 0;
+}
+
+//xorshift64*, one per worker so that workers never share random state.
+static uint64_t Random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+//Spreads an address over the map, so that nearby branches land far apart.
+static inline uint16_t Scramble(const uint16_t address) {
+    return static_cast<uint16_t>((address * 0x9e3779b1u) >> 16);
+}
+
+//Instructions after which a pc other than the next instruction's is a taken branch.
+static constexpr bool Transfers(const int op) {
+    return EndsBlock(op) && op != 0x76 && op != 0xf3 && op != 0xfb;
+}
+
+//Rounds a hit count down to a power of two, so that a loop running a few more times than before is
+//not new coverage but one running twice or ten times as often is.
+static uint8_t Bucket(const uint8_t count) {
+    if (count <= 2)
+        return count;
+    if (count == 3)
+        return 4;
+    if (count < 8)
+        return 8;
+    if (count < 16)
+        return 16;
+    if (count < 32)
+        return 32;
+    return count < 128 ? 64 : 128;
+}
+
+//RunBlocks, recording in trace every branch taken at the end of a block. Blocks that stopped short,
+//at the budget or on a store into themselves, did not get to their branch.
+static void RunTraced(State8080* state, BlockCache* cache, const uint64_t cycle_budget, uint8_t* trace) {
+    RunResult result = {0, 0};
+    while (result.cycles < cycle_budget && !state->halted) {
+        if (!cache->retired.empty())
+            cache->retired.clear();
+
+        const CodeBlock* block = FindBlock(cache, state, state->pc);
+        const uint16_t start = block->start;
+        const uint16_t next = start + block->length;
+        const DecodedOp& last = block->ops.back();
+        const uint16_t from = next - last.length;
+        const int op = last.opcode;
+        const uint64_t before = result.instructions;
+        uint64_t taken;
+        uint16_t to;
+        if (block->loop != LOOP_NONE) {
+            RunIdleLoop(state, block, result, cycle_budget);
+            //Fast-forwarded iterations are counted as if they ran, and every iteration that got to its
+            //end branched back to start but one that left the loop, so the hit count is what running
+            //each iteration would have given.
+            const uint64_t iterations = (result.instructions - before) / block->ops.size();
+            taken = iterations - (iterations != 0 && state->pc == next);
+            to = start;
+        } else {
+            RunCodeBlock(state, block, result, cycle_budget);
+            taken = result.instructions - before == block->ops.size() && state->pc != next;
+            to = state->pc;
+        }
+
+        if (taken != 0 && Transfers(op)) {
+            uint8_t& hits = trace[(Scramble(from) >> 1 ^ Scramble(to)) & (FUZZ_MAP_SIZE - 1)];
+            hits = static_cast<uint8_t>(std::min<uint64_t>(hits + taken, 0xff));
+        }
+    }
+    cache->retired.clear();
+}
+
+//Applies a stack of random byte edits to input, occasionally splicing in part of other.
+static void Mutate(std::vector<uint8_t>* input, const std::vector<uint8_t>& other, const size_t limit,
+                   uint64_t* random) {
+    static const uint8_t interesting[] = {0x00, 0x01, 0x02, 0x0a, 0x0d, 0x10, 0x20, 0x30, 0x41, 0x61,
+                                          0x7f, 0x80, 0x81, 0xfe, 0xff};
+    const int edits = 1 << (Random(random) % 4);
+    for (int edit = 0; edit < edits; edit++) {
+        const uint64_t choice = Random(random);
+        const size_t size = input->size();
+        const size_t at = size == 0 ? 0 : (choice >> 8) % size;
+        switch (size == 0 ? 4 : choice % 8) {
+            case 0:
+                (*input)[at] ^= 1 << ((choice >> 40) % 8);
+                break;
+            case 1:
+                (*input)[at] = static_cast<uint8_t>(choice >> 40);
+                break;
+            case 2:
+                (*input)[at] = interesting[(choice >> 40) % sizeof(interesting)];
+                break;
+            case 3:
+                (*input)[at] += static_cast<uint8_t>((choice >> 40) % 17) - 8;
+                break;
+            case 4:
+            case 5:
+                if (size < limit)
+                    input->insert(input->begin() + (size == 0 ? 0 : (choice >> 8) % (size + 1)),
+                                  static_cast<uint8_t>(choice >> 40));
+                break;
+            case 6:
+                if (size > 1)
+                    input->erase(input->begin() + at);
+                break;
+            default:
+                //Keeps the head of input and takes the rest from other.
+                if (!other.empty()) {
+                    const size_t from = (choice >> 40) % other.size();
+                    input->resize(at);
+                    input->insert(input->end(), other.begin() + from, other.end());
+                    if (input->size() > limit)
+                        input->resize(limit);
+                }
+                break;
+        }
+    }
+}
+
+static void RunWorker(Fuzzer* fuzzer, const unsigned worker, bool* ok) {
+    const FuzzConfig& config = *fuzzer->config;
+    std::unique_ptr<MemoryArena, void (*)(MemoryArena*)> arena(CloneArena(fuzzer->image), DestroyArena);
+    if (!arena) {
+        *ok = false;
+        return;
+    }
+    std::unique_ptr<BlockCache> cache(new BlockCache());
+    std::unique_ptr<uint8_t[]> trace(new uint8_t[FUZZ_MAP_SIZE]());
+    std::vector<std::pair<uint16_t, uint8_t>> hits;
+    const size_t limit = config.input_size != 0 ? config.input_size : FUZZ_MAX_INPUT;
+    uint64_t random = (config.seed + worker) * 0x9e3779b97f4a7c15ULL | 1;
+
+    for (uint64_t run; (run = fuzzer->started++) < config.runs;) {
+        std::vector<uint8_t> input;
+        std::vector<uint8_t> other;
+        {
+            std::lock_guard<std::mutex> hold(fuzzer->lock);
+            const std::vector<std::vector<uint8_t>>& corpus = *fuzzer->corpus;
+            if (run < fuzzer->seeds) {
+                input = corpus[run];
+            } else {
+                input = corpus[Random(&random) % corpus.size()];
+                other = corpus[Random(&random) % corpus.size()];
+            }
+        }
+        if (run >= fuzzer->seeds)
+            Mutate(&input, other, limit, &random);
+
+        FuzzPorts ports = {&input, 0};
+        State8080 state = {};
+        state.memory = arena->memory;
+        state.pc = fuzzer->pc;
+        state.blocks = cache.get();
+        if (config.input_size == 0) {
+            state.port_in = FuzzIn;
+            state.devices = &ports;
+        } else {
+            //Stored the way the program would, so the pages are dirtied and put back after the run.
+            for (size_t i = 0; i < config.input_size; i++)
+                Write8(&state, static_cast<uint16_t>(config.input_address + i), i < input.size() ? input[i] : 0);
+        }
+
+        RunTraced(&state, cache.get(), config.cycles, trace.get());
+        RestoreDirtyPages(&state, fuzzer->image->memory);
+
+        //Collects and clears the entries this run hit, a word at a time since most of the map is zero.
+        hits.clear();
+        for (int word = 0; word < FUZZ_MAP_SIZE; word += 8) {
+            uint64_t any;
+            std::memcpy(&any, &trace[word], sizeof(any));
+            if (any == 0)
+                continue;
+            for (int entry = word; entry < word + 8; entry++) {
+                if (trace[entry] != 0)
+                    hits.emplace_back(static_cast<uint16_t>(entry), Bucket(trace[entry]));
+            }
+            std::memset(&trace[word], 0, sizeof(any));
+        }
+
+        std::lock_guard<std::mutex> hold(fuzzer->lock);
+        bool found = false;
+        for (const std::pair<uint16_t, uint8_t>& hit : hits) {
+            if (hit.second & ~fuzzer->seen[hit.first]) {
+                fuzzer->seen[hit.first] |= hit.second;
+                found = true;
+            }
+        }
+        if (found && run >= fuzzer->seeds)
+            fuzzer->corpus->push_back(std::move(input));
+    }
+}
+
+bool Fuzz(const ArenaImage* image, const uint16_t pc, const FuzzConfig& config,
+          std::vector<std::vector<uint8_t>>* corpus, FuzzResult* result) {
+    unsigned threads = config.threads != 0 ? config.threads : std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    Fuzzer fuzzer;
+    fuzzer.image = image;
+    fuzzer.pc = pc;
+    fuzzer.config = &config;
+    fuzzer.started = 0;
+    fuzzer.corpus = corpus;
+    fuzzer.seen.assign(FUZZ_MAP_SIZE, 0);
+    bool empty = false;
+    for (const std::vector<uint8_t>& input : *corpus)
+        empty = empty || input.empty();
+    if (!empty)
+        corpus->insert(corpus->begin(), std::vector<uint8_t>());
+    fuzzer.seeds = corpus->size();
+
+    std::unique_ptr<bool[]> ok(new bool[threads]);
+    std::vector<std::thread> workers;
+    for (unsigned worker = 0; worker < threads; worker++)
+        ok[worker] = true;
+    for (unsigned worker = 1; worker < threads; worker++)
+        workers.emplace_back(RunWorker, &fuzzer, worker, &ok[worker]);
+    RunWorker(&fuzzer, 0, &ok[0]);
+    for (std::thread& worker : workers)
+        worker.join();
+
+    result->runs = fuzzer.started < config.runs ? fuzzer.started.load() : config.runs;
+    result->edges = 0;
+    for (const uint8_t buckets : fuzzer.seen)
+        result->edges += buckets != 0;
+    for (unsigned worker = 0; worker < threads; worker++) {
+        if (!ok[worker])
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef FUZZ8080_H
+#define FUZZ8080_H
+
+#include <cstdint>
+#include <vector>
+
+#include "arena8080.h"
+#include "cpu8080.h"
+
+//Entries in a coverage map. Each taken jump, call, return, RST or PCHL bumps the entry its source and
+//target hash to, AFL style, so the map records which edges a run took and roughly how often.
+constexpr int FUZZ_MAP_SIZE = 0x10000;
+constexpr size_t FUZZ_MAX_INPUT = 1024;     //longest input mutation grows to
+constexpr uint64_t FUZZ_RUNS = 100000;      //runs of a fuzzing session from the command line
+
+typedef struct FuzzConfig {
+    uint64_t    cycles;         //budget of each run
+    uint64_t    runs;           //runs over all workers, seeds included
+    unsigned    threads;        //0 for one per host core
+    uint16_t    input_address;  //where the input is stored before each run, when input_size is set
+    uint16_t    input_size;     //0 to feed the input to IN instead, byte by byte whatever the port
+    uint64_t    seed;           //of the mutations; workers derive theirs from it
+} FuzzConfig;
+
+typedef struct FuzzResult {
+    uint64_t    runs;
+    uint64_t    edges;          //map entries any run has hit
+} FuzzResult;
+
+//Fuzzes the program in image, starting each run at pc with the memory of image, on config.threads
+//workers. corpus holds the seed inputs, if any, and gets every input that made the program take an
+//edge, or an edge a number of times, that no run before it had; it always starts with the empty
+//input. Each worker runs from its own copy-on-write clone of image with a block cache, records
+//coverage between blocks and resets by putting back only the pages the run dirtied, so a run costs
+//little more than the code it executes. Returns false when a worker cannot get its memory.
+bool Fuzz(const ArenaImage* image, uint16_t pc, const FuzzConfig& config, std::vector<std::vector<uint8_t>>* corpus,
+          FuzzResult* result);
+
+#endif //FUZZ8080_H
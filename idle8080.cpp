@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cstring>
+
+#include "idle8080.h"
+#include "blocks8080.h"
+#include "ops8080.h"
+
+//Instructions that can leave the state as they found it when a loop repeats them and memory does not
+//change. Whether a loop made of them really does is checked each time it runs.
+static bool Idempotent(const int op) {
+    return op == 0x00 ||                                            //NOP
+           ((op & 0xc0) == 0x40 && (op & 0xf8) != 0x70) ||          //MOV, but not into M
+           ((op & 0xc7) == 0x06 && op != 0x36) ||                   //MVI, but not into M
+           (op & 0xcf) == 0x01 ||                                   //LXI
+           op == 0x0a || op == 0x1a || op == 0x2a || op == 0x3a ||  //LDAX, LHLD, LDA
+           (op & 0xf8) == 0xa0 || op == 0xaf ||                     //ANA, XRA A
+           (op & 0xf0) == 0xb0 ||                                   //ORA, CMP
+           op == 0xe6 || op == 0xf6 || op == 0xfe ||                //ANI, ORI, CPI
+           op == 0x37;                                              //STC
+}
+
+//The register index of the high and low halves of pair rp, as used in MOV and ALU opcodes.
+static int HighHalf(const int rp) { return rp * 2; }
+static int LowHalf(const int rp) { return rp * 2 + 1; }
+
+static uint8_t& Register(State8080* state, const int r) {
+    switch (r) {
+        case 0: return state->b;
+        case 1: return state->c;
+        case 2: return state->d;
+        case 3: return state->e;
+        case 4: return state->h;
+        case 5: return state->l;
+        default: return state->a;
+    }
+}
+
+static uint16_t& Pair(State8080* state, const int rp) {
+    switch (rp) {
+        case 0: return state->bc;
+        case 1: return state->de;
+        default: return state->hl;
+    }
+}
+
+//The register counted down by a DCR r / JNZ tail starting at ops[i], or -1.
+static int Counter8(const std::vector<DecodedOp>& ops, const size_t i) {
+    if (ops.size() != i + 2 || (ops[i].opcode & 0xc7) != 0x05 || ops[i].opcode == 0x35 || ops[i + 1].opcode != 0xc2)
+        return -1;
+    return (ops[i].opcode >> 3) & 7;
+}
+
+//The pair counted down by a DCX rp / MOV A,hi / ORA lo / JNZ tail starting at ops[i], or -1.
+static int Counter16(const std::vector<DecodedOp>& ops, const size_t i) {
+    if (ops.size() != i + 4 || (ops[i].opcode & 0xcf) != 0x0b || ops[i].opcode == 0x3b || ops[i + 3].opcode != 0xc2)
+        return -1;
+
+    const int rp = (ops[i].opcode >> 4) & 3;
+    const int hi = HighHalf(rp), lo = LowHalf(rp);
+    if ((ops[i + 1].opcode == (0x78 | hi) && ops[i + 2].opcode == (0xb0 | lo)) ||
+        (ops[i + 1].opcode == (0x78 | lo) && ops[i + 2].opcode == (0xb0 | hi)))
+        return rp;
+    return -1;
+}
+
+static bool InPair(const int r, const int rp) {
+    return rp >= 0 && (r == HighHalf(rp) || r == LowHalf(rp));
+}
+
+//The parts of a copy or fill loop. Registers and pairs are numbered as in opcodes, -1 is none.
+typedef struct BulkLoop {
+    int         source;     //pair a copy loads through
+    int         dest;       //pair the loop stores through
+    int         value;      //register a fill stores, -1 for the immediate
+    uint8_t     immediate;
+    int         counter;    //register counted down by DCR
+    int         counter_pair;   //pair counted down by DCX
+} BulkLoop;
+
+//Matches ops against LOOP_COPY and LOOP_FILL, checking that the counter and the stored value are not
+//changed by anything else in the loop.
+static LoopKind ParseBulkLoop(const std::vector<DecodedOp>& ops, BulkLoop* loop) {
+    size_t i = 0;
+    loop->source = -1;
+    if (ops.size() > i && ops[i].opcode == 0x7e)
+        loop->source = RP_HL, i++;                  //MOV A,M
+    else if (ops.size() > i && (ops[i].opcode == 0x0a || ops[i].opcode == 0x1a))
+        loop->source = (ops[i].opcode >> 4) & 3, i++;   //LDAX
+
+    if (ops.size() <= i)
+        return LOOP_NONE;
+    const uint8_t store = ops[i].opcode;
+    loop->immediate = ops[i].operand & 0xff;
+    if (store == 0x36)
+        loop->dest = RP_HL, loop->value = -1;       //MVI M
+    else if ((store & 0xf8) == 0x70 && store != 0x76)
+        loop->dest = RP_HL, loop->value = store & 7;    //MOV M,r
+    else if (store == 0x02 || store == 0x12)
+        loop->dest = (store >> 4) & 3, loop->value = REG_A; //STAX
+    else
+        return LOOP_NONE;
+    i++;
+    if (loop->source == loop->dest || (loop->source >= 0 && loop->value != REG_A))
+        return LOOP_NONE;
+
+    //INX of the destination and, for a copy, of the source, in either order.
+    const size_t increments = loop->source >= 0 ? 2 : 1;
+    bool source_done = loop->source < 0, dest_done = false;
+    for (size_t end = i + increments; i < end; i++) {
+        if (ops.size() <= i || (ops[i].opcode & 0xcf) != 0x03)
+            return LOOP_NONE;
+        const int rp = (ops[i].opcode >> 4) & 3;
+        if (rp == loop->dest && !dest_done)
+            dest_done = true;
+        else if (rp == loop->source && !source_done)
+            source_done = true;
+        else
+            return LOOP_NONE;
+    }
+
+    loop->counter = Counter8(ops, i);
+    loop->counter_pair = Counter16(ops, i);
+    if (loop->counter >= 0) {
+        if (InPair(loop->counter, loop->dest) || InPair(loop->counter, loop->source) ||
+            loop->counter == loop->value || (loop->source >= 0 && loop->counter == REG_A))
+            return LOOP_NONE;
+    } else if (loop->counter_pair >= 0) {
+        //The tail loads A, so a fill can only store the immediate or a register outside the counter. A
+        //copy reloads A before each store, and RunBulkLoop leaves it as the tail does.
+        if (loop->counter_pair == loop->dest || loop->counter_pair == loop->source ||
+            (loop->source < 0 && loop->value == REG_A) || InPair(loop->value, loop->counter_pair))
+            return LOOP_NONE;
+    } else {
+        return LOOP_NONE;
+    }
+    if (InPair(loop->value, loop->dest))
+        return LOOP_NONE;
+
+    return loop->source >= 0 ? LOOP_COPY : LOOP_FILL;
+}
+
+LoopKind ClassifyLoop(const std::vector<DecodedOp>& ops, const uint16_t start) {
+    const DecodedOp& last = ops.back();
+    const bool jumps_back = (last.opcode == 0xc3 || last.opcode == 0xcb || (last.opcode & 0xc7) == 0xc2) &&
+                            last.operand == start;
+    if (!jumps_back)
+        return LOOP_NONE;
+
+    if (Counter8(ops, 0) >= 0)
+        return LOOP_COUNT8;
+    if (Counter16(ops, 0) >= 0)
+        return LOOP_COUNT16;
+
+    BulkLoop loop;
+    const LoopKind bulk = ParseBulkLoop(ops, &loop);
+    if (bulk != LOOP_NONE)
+        return bulk;
+
+    for (size_t i = 0; i + 1 < ops.size(); i++) {
+        if (!Idempotent(ops[i].opcode))
+            return LOOP_NONE;
+    }
+    return LOOP_SPIN;
+}
+
+static bool SameRegisters(State8080 x, State8080 y) {
+    DefaultFlags::Settle(&x);
+    DefaultFlags::Settle(&y);
+    return x.a == y.a && x.bc == y.bc && x.de == y.de && x.hl == y.hl && x.sp == y.sp && x.pc == y.pc &&
+           x.cc.psw == y.cc.psw;
+}
+
+//How many of the count bytes from address on can be stored to before one that holds cached code,
+//at its own address or at any mirror of it.
+static uint32_t CodeFree(const State8080* state, const uint16_t address, const uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        const uint16_t at = address + i;
+        if (CachedCode(state, at))
+            return i;
+        if (state->memory != nullptr)
+            continue;
+        for (int page = state->bus->mirror[at >> 8]; page != at >> 8; page = state->bus->mirror[page]) {
+            if (CachedCode(state, static_cast<uint16_t>(page << 8 | (at & 0xff))))
+                return i;
+        }
+    }
+    return count;
+}
+
+//A byte-at-a-time copy upwards. When the destination starts inside the source it reads bytes it has
+//already stored and repeats the ones in between, which memmove would not do, so it is copied at most
+//that distance at a time. Source and destination are host memory, so this also holds for mirrors.
+static void ForwardCopy(uint8_t* dest, const uint8_t* source, const uint32_t count) {
+    const uintptr_t distance = reinterpret_cast<uintptr_t>(dest) - reinterpret_cast<uintptr_t>(source);
+    const uint32_t step = distance > 0 && distance < count ? static_cast<uint32_t>(distance) : count;
+    for (uint32_t done = 0; done < count; done += step)
+        std::memmove(dest + done, source + done, std::min(step, count - done));
+}
+
+//The copy and fill part of RunIdleLoop.
+static void RunBulkLoop(State8080* state, const CodeBlock* block, RunResult& result, const uint64_t fits,
+                        const uint64_t iteration) {
+    BulkLoop loop;
+    const LoopKind kind = ParseBulkLoop(block->ops, &loop);
+
+    uint8_t* const counter = loop.counter >= 0 ? &Register(state, loop.counter) : nullptr;
+    uint16_t* const counter_pair = loop.counter_pair >= 0 ? &Pair(state, loop.counter_pair) : nullptr;
+    const uint64_t iterations = counter != nullptr ? (*counter == 0 ? 0x100 : *counter)
+                                                   : (*counter_pair == 0 ? 0x10000 : *counter_pair);
+    uint16_t& dest = Pair(state, loop.dest);
+    uint64_t skipped = std::min({iterations - 1, fits, static_cast<uint64_t>(0x10000 - dest)});
+    if (kind == LOOP_COPY)
+        skipped = std::min<uint64_t>(skipped, 0x10000 - Pair(state, loop.source));
+    skipped = CodeFree(state, dest, static_cast<uint32_t>(skipped));
+    if (skipped == 0)
+        return;
+
+    //Only host memory can be moved in bulk; a device page or ROM in the way leaves every iteration
+    //to the interpreter.
+    const uint32_t count = static_cast<uint32_t>(skipped);
+    uint8_t* const host = HostDestination(state, dest, count);
+    if (host == nullptr)
+        return;
+    if (kind == LOOP_COPY) {
+        uint16_t& source = Pair(state, loop.source);
+        const uint8_t* const from = HostSource(state, source, count);
+        if (from == nullptr)
+            return;
+        ForwardCopy(host, from, count);
+        state->a = host[count - 1];
+        source += count;
+    } else {
+        std::memset(host, loop.value >= 0 ? Register(state, loop.value) : loop.immediate, count);
+    }
+    for (uint32_t page = dest >> 8; page <= (dest + count - 1u) >> 8; page++)
+        state->dirty[page] = 1;
+    dest += count;
+
+    //The budget may stop the next iteration before it gets to its counter, so the counter, A and the
+    //flags have to be what the last skipped iteration left.
+    if (counter != nullptr) {
+        *counter -= static_cast<uint8_t>(count);
+        DefaultFlags::Dec(state, *counter);
+    } else {
+        *counter_pair -= static_cast<uint16_t>(count);
+        const size_t tail = block->ops.size() - 4;
+        state->a = Register(state, block->ops[tail + 1].opcode & 7) | Register(state, block->ops[tail + 2].opcode & 7);
+        DefaultFlags::Logic(state, state->a);
+    }
+    result.cycles += skipped * iteration;
+    result.instructions += skipped * block->ops.size();
+}
+
+void RunIdleLoop(State8080* state, const CodeBlock* block, RunResult& result, const uint64_t cycle_budget) {
+    //A taken Jcc costs the same as one that falls through, so every iteration takes the same time.
+    const uint64_t iteration = block->lead_cycles + block->ops.back().cycles;
+
+    if (block->loop == LOOP_SPIN) {
+        //A read from a device page may see a different value next time, which ends the spin.
+        const State8080 before = *state;
+        const uint64_t handler_reads = state->memory == nullptr ? state->bus->handler_reads : 0;
+        RunCodeBlock(state, block, result, cycle_budget);
+        if (result.cycles >= cycle_budget || !SameRegisters(before, *state) ||
+            (state->memory == nullptr && state->bus->handler_reads != handler_reads))
+            return;
+
+        const uint64_t skipped = (cycle_budget - result.cycles - 1) / iteration;
+        result.cycles += skipped * iteration;
+        result.instructions += skipped * block->ops.size();
+        return;
+    }
+
+    const uint64_t fits = (cycle_budget - result.cycles - 1) / iteration;   //iterations that end short of the budget
+    if (block->loop == LOOP_COPY || block->loop == LOOP_FILL) {
+        RunBulkLoop(state, block, result, fits, iteration);
+        RunCodeBlock(state, block, result, cycle_budget);
+        return;
+    }
+
+    uint64_t skipped = 0;
+    if (block->loop == LOOP_COUNT8) {
+        uint8_t& counter = Register(state, (block->ops[0].opcode >> 3) & 7);
+        const uint64_t iterations = counter == 0 ? 0x100 : counter;
+        skipped = std::min(iterations - 1, fits);
+        //The DCR of the iteration that runs rewrites every flag it touches, and JNZ reads only Z.
+        counter -= static_cast<uint8_t>(skipped);
+    } else {
+        const int rp = (block->ops[0].opcode >> 4) & 3;
+        uint16_t& counter = Pair(state, rp);
+        const uint64_t iterations = counter == 0 ? 0x10000 : counter;
+        skipped = std::min(iterations - 1, fits);
+        if (skipped > 0) {
+            //The budget may stop the next iteration right after its DCX, so A and the flags have to
+            //be what the last skipped iteration left.
+            counter -= static_cast<uint16_t>(skipped);
+            state->a = Register(state, block->ops[1].opcode & 7);
+            state->a |= Register(state, block->ops[2].opcode & 7);
+            DefaultFlags::Logic(state, state->a);
+        }
+    }
+    result.cycles += skipped * iteration;
+    result.instructions += skipped * block->ops.size();
+
+    RunCodeBlock(state, block, result, cycle_budget);
+}
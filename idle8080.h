@@ -0,0 +1,38 @@
+#ifndef IDLE8080_H
+#define IDLE8080_H
+
+#include <cstdint>
+#include <vector>
+
+#include "cpu8080.h"
+#include "predecode8080.h"
+
+//Loops whose iterations can be carried out all at once instead of one instruction at a time, either
+//because they only spend time or because all they do is move bytes. Each is a block that ends in a
+//jump back to its own start. The copy and fill loops count down with DCR r / JNZ or with the
+//DCX / MOV / ORA / JNZ tail of LOOP_COUNT16.
+enum LoopKind : uint8_t {
+    LOOP_NONE,
+    LOOP_SPIN,      //only loads, compares and idempotent logic, e.g. LDA x / ANA A / JZ back or JMP $
+    LOOP_COUNT8,    //DCR r / JNZ back
+    LOOP_COUNT16,   //DCX rp / MOV A,hi / ORA lo / JNZ back, the halves in either order
+    LOOP_COPY,      //MOV A,M or LDAX / MOV M,A or STAX / INX source / INX dest / count, INX in either order
+    LOOP_FILL,      //MVI M,n, MOV M,r or STAX / INX dest / count
+};
+
+struct CodeBlock;
+
+//Recognizes the loop shapes above in the decoded ops of the block at start.
+LoopKind ClassifyLoop(const std::vector<DecodedOp>& ops, uint16_t start);
+
+//RunCodeBlock for a block whose loop is not LOOP_NONE. A spin loop is run once, and if that left
+//every register and flag as it found them it cannot exit until an interrupt, so the iterations left
+//before the budget are only counted. A counted loop skips straight to its last iteration, or to the
+//last one that fits the budget, and a copy or fill loop does the same with one host memmove or memset
+//for the bytes it skips. Copies and fills stop short of any byte that holds cached code so that
+//their stores still invalidate it, and short of the end of memory. At least one iteration always
+//runs for real, so the run stops on the same instruction, with the same registers, flags and memory,
+//as interpreting every iteration would.
+void RunIdleLoop(State8080* state, const CodeBlock* block, RunResult& result, uint64_t cycle_budget);
+
+#endif //IDLE8080_H
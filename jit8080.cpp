@@ -0,0 +1,741 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+
+#include "jit8080.h"
+#include "ops8080.h"
+
+//Translated code is x86-64 and the code buffer comes from mmap, so the JIT only exists there. Other
+//builds keep the entry points and report that no translation is possible.
+#if defined(I8080_JIT) && defined(__x86_64__) && defined(__linux__)
+#define JIT_AVAILABLE 1
+#else
+#define JIT_AVAILABLE 0
+#endif
+
+#if JIT_AVAILABLE
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+constexpr size_t JIT_CODE_SIZE = 16 << 20;
+constexpr size_t JIT_BLOCK_CODE_SIZE = 64 << 10;   //more than the largest translation of one block
+constexpr size_t JIT_ENTER_OFFSET = 128;           //the exit trampoline sits before it
+constexpr uint64_t JIT_HOT_THRESHOLD = 16;
+
+//What RunJitBlock hands to translated code and gets back from it.
+typedef struct JitRun {
+    uint64_t        cycles;
+    uint64_t        instructions;
+    uint64_t        budget;
+    const uint8_t   *cover;
+    uint8_t         *memory;
+} JitRun;
+
+typedef void (*JitEnter)(State8080* state, JitRun* run, const uint8_t* code);
+typedef int (*JitHelper)(State8080* state, uint16_t operand);
+
+enum HostReg { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum HostReg8 { AL, CL, DL, BL, AH, CH, DH, BH };
+
+//Guest registers stay in host registers for as long as translated code runs. A and the PSW share
+//eax, with the flags in AH where LAHF and SAHF move them, since the x86 flags byte has the same
+//layout as the 8080 PSW. BC, DE and HL sit in bx, cx and dx, so every 8080 register is one byte
+//half of them. rbp holds the memory base, r12 the state, r13 and r15 the cycle and instruction
+//counts, r14 the BlockCache cover map, and [rsp] the budget.
+constexpr int host_reg8[8] = {BH, BL, CH, CL, DH, DL, -1, AL};     //B C D E H L (M) A
+constexpr int host_pair[3] = {RBX, RCX, RDX};                       //BC DE HL
+
+constexpr int32_t OFFSET_A = offsetof(State8080, a);
+constexpr int32_t OFFSET_BC = offsetof(State8080, bc);
+constexpr int32_t OFFSET_DE = offsetof(State8080, de);
+constexpr int32_t OFFSET_HL = offsetof(State8080, hl);
+constexpr int32_t OFFSET_SP = offsetof(State8080, sp);
+constexpr int32_t OFFSET_PC = offsetof(State8080, pc);
+constexpr int32_t OFFSET_PSW = offsetof(State8080, cc.psw);
+constexpr int32_t OFFSET_DIRTY = offsetof(State8080, dirty);
+
+//x86 opcodes of ADD ADC SUB SBB ANA XRA ORA CMP with an r/m8 destination.
+constexpr uint8_t host_alu[8] = {0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38};
+
+//Flag use of an instruction, for dropping flag results that are overwritten before anything reads
+//them. Stores count as reads because a store into the running block leaves it mid-way, and the
+//interpreter that takes over must find the flags up to date.
+enum FlagUse { FLAGS_UNUSED, FLAGS_READ, FLAGS_WRITTEN };
+
+constexpr int GetFlagUse(const int op) {
+    if (StoresToMemory(op) || EndsBlock(op))
+        return FLAGS_READ;
+    if ((op & 0xe8) == 0x88 || (op & 0xef) == 0xce)
+        return FLAGS_READ;                              //ADC SBB ACI SBI take the carry in
+    if ((op & 0xc0) == 0x80 || (op & 0xc7) == 0xc6)
+        return FLAGS_WRITTEN;                           //ALU ops replace all five flags
+    if ((op & 0xc6) == 0x04 || (op & 0xcf) == 0x09 || op == 0x07 || op == 0x0f || op == 0x17 || op == 0x1f ||
+        op == 0x27 || op == 0x37 || op == 0x3f || op == 0xf5)
+        return FLAGS_READ;                              //INR DCR DAD rotates DAA STC CMC PUSH PSW
+    return FLAGS_UNUSED;
+}
+
+template <std::size_t... OPS>
+constexpr std::array<JitHelper, 256> MakeHelperTable(std::index_sequence<OPS...>) {
+    return {{&Execute<OPS, EagerFlags>...}};
+}
+
+//Instructions without a translation of their own run through their interpreter handler.
+static constexpr std::array<JitHelper, 256> helpers = MakeHelperTable(std::make_index_sequence<256>{});
+
+//Slow path of a translated store, taken when it hits cached code.
+static void JitStore(State8080* state, const uint16_t address, const uint8_t value) {
+    Write8(state, address, value);
+}
+
+//Just enough of an x86-64 assembler for the translations. p and the jump sites are addresses in the
+//executable view of the code buffer, which is what relative jumps are computed against; the bytes go
+//through the writable view.
+struct Emitter {
+    uint8_t     *p;
+    ptrdiff_t   writable;   //from a byte of the executable view to the same byte of the writable one
+
+    void Byte(const int value) { p[writable] = static_cast<uint8_t>(value); p++; }
+    void Word(const uint16_t value) { std::memcpy(p + writable, &value, 2); p += 2; }
+    void Dword(const uint32_t value) { std::memcpy(p + writable, &value, 4); p += 4; }
+    void Qword(const uint64_t value) { std::memcpy(p + writable, &value, 8); p += 8; }
+
+    //Points the rel32 field at site to target.
+    void Patch(uint8_t* site, const uint8_t* target) const {
+        const int32_t rel = static_cast<int32_t>(target - (site + 4));
+        std::memcpy(site + writable, &rel, 4);
+    }
+
+    //No REX byte is emitted when none is needed, so AH, BH, CH and DH stay encodable.
+    void Rex(const bool wide, const int reg, const int index, const int base) {
+        const int rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+        if (rex != 0x40)
+            Byte(rex);
+    }
+
+    //op reg, [base + index + disp32], without an index when index is -1.
+    void Mem(const int prefix, const bool wide, const std::initializer_list<int> op, const int reg, const int base,
+             const int index, const int32_t disp) {
+        if (prefix)
+            Byte(prefix);
+        Rex(wide, reg, index < 0 ? 0 : index, base);
+        for (const int b : op)
+            Byte(b);
+        if (index < 0 && (base & 7) != RSP) {
+            Byte(0x80 | (reg & 7) << 3 | (base & 7));
+        } else {
+            Byte(0x84 | (reg & 7) << 3);
+            Byte(((index < 0 ? RSP : index) & 7) << 3 | (base & 7));
+        }
+        Dword(disp);
+    }
+
+    //op rm, reg between two registers. reg is the opcode extension for single-operand forms.
+    void Reg(const int prefix, const bool wide, const std::initializer_list<int> op, const int reg, const int rm) {
+        if (prefix)
+            Byte(prefix);
+        Rex(wide, reg, 0, rm);
+        for (const int b : op)
+            Byte(b);
+        Byte(0xc0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    //A jump with a rel32 operand. Returns the operand so it can be patched.
+    uint8_t* Jump(const std::initializer_list<int> op) {
+        for (const int b : op)
+            Byte(b);
+        uint8_t* site = p;
+        Dword(0);
+        return site;
+    }
+
+    void AddImmediate(const int reg, const uint32_t value) {
+        Reg(0, true, {0x81}, 0, reg);
+        Dword(value);
+    }
+
+    void SetPC(const uint16_t pc) {
+        Mem(0x66, false, {0xc7}, 0, R12, -1, OFFSET_PC);
+        Word(pc);
+    }
+
+    void StoreGuest() {
+        Mem(0, false, {0x88}, AL, R12, -1, OFFSET_A);
+        Reg(0, false, {0x89}, RAX, RDI);                //mov edi, eax
+        Reg(0, false, {0xc1}, 5, RDI);                  //shr edi, 8
+        Byte(8);
+        Mem(0, false, {0x88}, RDI, R12, -1, OFFSET_PSW); //dil, as the r12 base forces a REX byte
+        Mem(0x66, false, {0x89}, RBX, R12, -1, OFFSET_BC);
+        Mem(0x66, false, {0x89}, RCX, R12, -1, OFFSET_DE);
+        Mem(0x66, false, {0x89}, RDX, R12, -1, OFFSET_HL);
+    }
+
+    void LoadGuest() {
+        Mem(0, false, {0x0f, 0xb6}, RAX, R12, -1, OFFSET_A);
+        Mem(0, false, {0x0f, 0xb6}, RDI, R12, -1, OFFSET_PSW);
+        Reg(0, false, {0xc1}, 4, RDI);                  //shl edi, 8
+        Byte(8);
+        Reg(0, false, {0x09}, RDI, RAX);                //or eax, edi
+        Mem(0, false, {0x0f, 0xb7}, RBX, R12, -1, OFFSET_BC);
+        Mem(0, false, {0x0f, 0xb7}, RCX, R12, -1, OFFSET_DE);
+        Mem(0, false, {0x0f, 0xb7}, RDX, R12, -1, OFFSET_HL);
+    }
+
+    void Call(const void* function) {
+        Reg(0, true, {0x89}, R12, RDI);                 //mov rdi, r12
+        Byte(0x48);                                     //mov rax, function
+        Byte(0xb8);
+        Qword(reinterpret_cast<uint64_t>(function));
+        Byte(0xff);                                     //call rax
+        Byte(0xd0);
+    }
+};
+
+//A jump out of the block being translated, to the stub that sets pc and leaves translated code.
+typedef struct PendingExit {
+    uint8_t     *site;
+    uint16_t    target;
+    bool        link;       //may be chained to the translation of target
+} PendingExit;
+
+//Translation state for one block.
+struct Translator {
+    JitCache    *jit;
+    CodeBlock   *block;
+    Emitter     e;
+    const uint8_t   *exit;
+    std::vector<PendingExit>    exits;
+
+    void Exit(const std::initializer_list<int> op, const uint16_t target, const bool link = true) {
+        exits.push_back({e.Jump(op), target, link});
+    }
+
+    //Leaves the block after instruction index when a store invalidated it. pc and the counts are
+    //brought up to that instruction so the interpreter continues with the next one.
+    void CheckValid(const size_t index, const uint16_t next, const uint32_t cycles) {
+        e.Byte(0x48);                                   //mov rsi, &block->valid
+        e.Byte(0xbe);
+        e.Qword(reinterpret_cast<uint64_t>(&block->valid));
+        e.Mem(0, false, {0x80}, 7, RSI, -1, 0);         //cmp byte [rsi], 0
+        e.Byte(0);
+        uint8_t* valid = e.Jump({0x0f, 0x85});
+        e.AddImmediate(R13, cycles);
+        e.AddImmediate(R15, static_cast<uint32_t>(index + 1));
+        e.SetPC(next);
+        e.Patch(e.Jump({0xe9}), exit);
+        e.Patch(valid, e.p);
+    }
+
+    //Stores value (a host byte register, or imm when value is -1) at address, or at HL/BC/DE already
+    //zero-extended into esi when address is -1, and marks its page dirty. Stores into cached code go
+    //through Write8.
+    void Store(const int address, const int value, const uint8_t imm, const size_t index, const uint16_t next,
+               const uint32_t cycles) {
+        const int index_reg = address < 0 ? RSI : -1;
+        const int32_t disp = address < 0 ? 0 : address;
+
+        e.Mem(0, false, {0x80}, 7, R14, index_reg, disp);   //cmp byte [cover + address], 0
+        e.Byte(0);
+        uint8_t* slow = e.Jump({0x0f, 0x85});
+        if (value >= 0) {
+            e.Mem(0, false, {0x88}, value, RBP, index_reg, disp);
+        } else {
+            e.Mem(0, false, {0xc6}, 0, RBP, index_reg, disp);
+            e.Byte(imm);
+        }
+        if (address < 0) {
+            e.Reg(0, false, {0x89}, RSI, RDI);          //mov edi, esi
+            e.Reg(0, false, {0xc1}, 5, RDI);            //shr edi, 8
+            e.Byte(8);
+            e.Mem(0, false, {0xc6}, 0, R12, RDI, OFFSET_DIRTY);    //mov byte [state->dirty + page], 1
+        } else {
+            e.Mem(0, false, {0xc6}, 0, R12, -1, OFFSET_DIRTY + (address >> 8));
+        }
+        e.Byte(1);
+        uint8_t* done = e.Jump({0xe9});
+
+        e.Patch(slow, e.p);
+        e.StoreGuest();
+        if (address >= 0) {
+            e.Byte(0xbe);                               //mov esi, address
+            e.Dword(address);
+        }
+        if (value >= 0) {
+            e.Reg(0, false, {0x0f, 0xb6}, RDX, value);  //movzx edx, value
+        } else {
+            e.Byte(0xba);                               //mov edx, imm
+            e.Dword(imm);
+        }
+        e.Call(reinterpret_cast<const void*>(&JitStore));
+        e.LoadGuest();
+        CheckValid(index, next, cycles);
+        e.Patch(done, e.p);
+    }
+
+    //ALU operation oper on A and a host byte register, the byte at HL (source M) or an immediate
+    //(source -1).
+    void Alu(const int oper, const int source, const uint8_t imm, const bool live) {
+        if (oper == ALU_CMP && !live)
+            return;
+
+        if (source == REG_M)
+            e.Reg(0, false, {0x0f, 0xb7}, RSI, RDX);    //movzx esi, dx
+        if (oper == ALU_ANA && live) {
+            //AC is bit 3 of a | b, moved to bit 4 of AH.
+            if (source == REG_M)
+                e.Mem(0, false, {0x0f, 0xb6}, RDI, RBP, RSI, 0);
+            else if (source >= 0)
+                e.Reg(0, false, {0x0f, 0xb6}, RDI, host_reg8[source]);
+            else {
+                e.Byte(0xbf);
+                e.Dword(imm);
+            }
+            e.Reg(0, false, {0x09}, RAX, RDI);          //or edi, eax
+            e.Reg(0, false, {0x83}, 4, RDI);            //and edi, 8
+            e.Byte(8);
+            e.Reg(0, false, {0xc1}, 4, RDI);            //shl edi, 9
+            e.Byte(9);
+        }
+        if (oper == ALU_ADC || oper == ALU_SBB) {
+            e.Reg(0, false, {0x0f, 0xba}, 4, RAX);      //bt eax, 8 copies CY to the host carry
+            e.Byte(8);
+        }
+
+        if (source == REG_M) {
+            e.Mem(0, false, {host_alu[oper] + 2}, AL, RBP, RSI, 0);
+        } else if (source >= 0) {
+            e.Reg(0, false, {host_alu[oper]}, host_reg8[source], AL);
+        } else {
+            e.Byte(host_alu[oper] + 4);
+            e.Byte(imm);
+        }
+
+        if (!live)
+            return;
+        e.Byte(0x9f);                                   //lahf
+        if (oper == ALU_SUB || oper == ALU_SBB || oper == ALU_CMP) {
+            e.Reg(0, false, {0x80}, 6, AH);             //xor ah, FLAG_AC: x86 sets AF on a borrow
+            e.Byte(FLAG_AC);
+        } else if (oper != ALU_ADD && oper != ALU_ADC) {
+            e.Reg(0, false, {0x80}, 4, AH);             //and ah, ~FLAG_AC
+            e.Byte(static_cast<uint8_t>(~FLAG_AC));
+            if (oper == ALU_ANA)
+                e.Reg(0, false, {0x09}, RDI, RAX);      //or eax, edi
+        }
+    }
+
+    //Runs an instruction through its interpreter handler.
+    void Helper(const DecodedOp& op, const uint16_t next) {
+        e.StoreGuest();
+        e.SetPC(next);
+        e.Byte(0xbe);                                   //mov esi, operand
+        e.Dword(op.operand);
+        e.Call(reinterpret_cast<const void*>(helpers[op.opcode]));
+    }
+
+    //Emits a native translation of op and returns true, or returns false when it has none.
+    bool Native(const DecodedOp& op, const size_t index, const uint16_t next, const uint32_t cycles,
+                const bool live) {
+        const int opcode = op.opcode;
+        const int ddd = (opcode >> 3) & 7;
+        const int sss = opcode & 7;
+        const int rp = (opcode >> 4) & 3;
+
+        if ((opcode & 0xc7) == 0x00) {                  //NOP
+        } else if ((opcode & 0xc0) == 0x40 && opcode != 0x76) {     //MOV
+            if (ddd == REG_M) {
+                e.Reg(0, false, {0x0f, 0xb7}, RSI, RDX);
+                Store(-1, host_reg8[sss], 0, index, next, cycles);
+            } else if (sss == REG_M) {
+                e.Reg(0, false, {0x0f, 0xb7}, RSI, RDX);
+                e.Mem(0, false, {0x8a}, host_reg8[ddd], RBP, RSI, 0);
+            } else if (ddd != sss) {
+                e.Reg(0, false, {0x88}, host_reg8[sss], host_reg8[ddd]);
+            }
+        } else if ((opcode & 0xc7) == 0x06) {           //MVI
+            if (ddd == REG_M) {
+                e.Reg(0, false, {0x0f, 0xb7}, RSI, RDX);
+                Store(-1, -1, op.operand & 0xff, index, next, cycles);
+            } else {
+                e.Byte(0xb0 + host_reg8[ddd]);
+                e.Byte(op.operand & 0xff);
+            }
+        } else if ((opcode & 0xc0) == 0x80) {           //ADD ADC SUB SBB ANA XRA ORA CMP
+            Alu(ddd, sss, 0, live);
+        } else if ((opcode & 0xc7) == 0xc6) {           //ADI ACI SUI SBI ANI XRI ORI CPI
+            Alu(ddd, -1, op.operand & 0xff, live);
+        } else if ((opcode & 0xc6) == 0x04 && ddd != REG_M) {       //INR DCR
+            const bool dcr = opcode & 1;
+            if (live)
+                e.Byte(0x9e);                           //sahf, so INC and DEC keep CY
+            e.Reg(0, false, {0xfe}, dcr ? 1 : 0, host_reg8[ddd]);
+            if (live) {
+                e.Byte(0x9f);
+                if (dcr) {
+                    e.Reg(0, false, {0x80}, 6, AH);
+                    e.Byte(FLAG_AC);
+                }
+            }
+        } else if ((opcode & 0xcf) == 0x03 || (opcode & 0xcf) == 0x0b) {   //INX DCX
+            const int extension = (opcode & 0x08) ? 1 : 0;
+            if (rp == RP_SP)
+                e.Mem(0x66, false, {0xff}, extension, R12, -1, OFFSET_SP);
+            else
+                e.Reg(0x66, false, {0xff}, extension, host_pair[rp]);
+        } else if ((opcode & 0xcf) == 0x01) {           //LXI
+            if (rp == RP_SP) {
+                e.Mem(0x66, false, {0xc7}, 0, R12, -1, OFFSET_SP);
+            } else {
+                e.Byte(0x66);
+                e.Byte(0xb8 + host_pair[rp]);
+            }
+            e.Word(op.operand);
+        } else if ((opcode & 0xcf) == 0x09 && rp != RP_SP) {        //DAD
+            e.Reg(0, false, {0x0f, 0xb7}, RSI, RDX);    //movzx esi, dx
+            e.Reg(0, false, {0x0f, 0xb7}, RDI, host_pair[rp]);
+            e.Reg(0, false, {0x01}, RDI, RSI);          //add esi, edi
+            e.Reg(0, false, {0x89}, RSI, RDX);          //mov edx, esi
+            if (live) {
+                e.Reg(0, false, {0xc1}, 5, RSI);        //shr esi, 16 leaves the carry out of bit 15
+                e.Byte(16);
+                e.Reg(0, false, {0xc1}, 4, RSI);        //shl esi, 8
+                e.Byte(8);
+                e.Reg(0, false, {0x80}, 4, AH);         //and ah, ~FLAG_CY
+                e.Byte(static_cast<uint8_t>(~FLAG_CY));
+                e.Reg(0, false, {0x09}, RSI, RAX);      //or eax, esi
+            }
+        } else if (opcode == 0x3a) {                    //LDA
+            e.Mem(0, false, {0x8a}, AL, RBP, -1, op.operand);
+        } else if (opcode == 0x32) {                    //STA
+            Store(op.operand, AL, 0, index, next, cycles);
+        } else if (opcode == 0x0a || opcode == 0x1a) {  //LDAX
+            e.Reg(0, false, {0x0f, 0xb7}, RSI, host_pair[rp]);
+            e.Mem(0, false, {0x8a}, AL, RBP, RSI, 0);
+        } else if (opcode == 0x02 || opcode == 0x12) {  //STAX
+            e.Reg(0, false, {0x0f, 0xb7}, RSI, host_pair[rp]);
+            Store(-1, AL, 0, index, next, cycles);
+        } else if (opcode == 0x2f) {                    //CMA
+            e.Reg(0, false, {0xf6}, 2, AL);
+        } else if (opcode == 0x37) {                    //STC
+            e.Reg(0, false, {0x80}, 1, AH);
+            e.Byte(FLAG_CY);
+        } else if (opcode == 0x3f) {                    //CMC
+            e.Reg(0, false, {0x80}, 6, AH);
+            e.Byte(FLAG_CY);
+        } else if (opcode == 0xeb) {                    //XCHG
+            e.Reg(0x66, false, {0x87}, RCX, RDX);
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    //The instruction that ends the block. cycles covers every instruction before it.
+    void Terminator(const DecodedOp& op, const size_t count, const uint16_t next, const uint32_t cycles) {
+        const int opcode = op.opcode;
+
+        if (opcode == 0xc3 || opcode == 0xcb || (opcode & 0xc7) == 0xc2) {    //JMP, Jcc
+            e.AddImmediate(R13, cycles + op.cycles);
+            e.AddImmediate(R15, static_cast<uint32_t>(count));
+            if ((opcode & 0xc7) != 0xc2) {
+                Exit({0xe9}, op.operand);
+                return;
+            }
+            //Jcc tests its flag in AH. Odd conditions jump when the flag is set.
+            constexpr uint8_t masks[4] = {FLAG_Z, FLAG_CY, FLAG_P, FLAG_S};
+            const int condition = (opcode >> 3) & 7;
+            e.Reg(0, false, {0xf6}, 0, AH);             //test ah, mask
+            e.Byte(masks[condition >> 1]);
+            Exit({0x0f, (condition & 1) ? 0x85 : 0x84}, op.operand);
+            Exit({0xe9}, next);
+            return;
+        }
+
+        Helper(op, next);
+        e.Reg(0, false, {0x89}, RAX, RAX);              //mov eax, eax clears the top of the handler's cycles
+        e.Reg(0, true, {0x01}, RAX, R13);               //add r13, rax
+        e.LoadGuest();
+        e.AddImmediate(R13, cycles);
+        e.AddImmediate(R15, static_cast<uint32_t>(count));
+
+        if ((opcode & 0xcf) == 0xcd) {                  //CALL
+            Exit({0xe9}, op.operand);
+        } else if ((opcode & 0xc7) == 0xc7) {           //RST
+            Exit({0xe9}, opcode & 0x38);
+        } else if ((opcode & 0xc7) == 0xc4) {           //Ccc
+            e.Mem(0x66, false, {0x81}, 7, R12, -1, OFFSET_PC);
+            e.Word(op.operand);
+            Exit({0x0f, 0x84}, op.operand);
+            Exit({0xe9}, next);
+        } else if ((opcode & 0xc7) == 0xc0) {           //Rcc
+            e.Mem(0x66, false, {0x81}, 7, R12, -1, OFFSET_PC);
+            e.Word(next);
+            Exit({0x0f, 0x84}, next);
+            e.Patch(e.Jump({0xe9}), exit);
+        } else if (opcode == 0xf3 || opcode == 0xfb) {  //DI, EI
+            Exit({0xe9}, next);
+        } else {                                        //RET, PCHL, HLT leave pc in the state
+            e.Patch(e.Jump({0xe9}), exit);
+        }
+    }
+
+    void Translate() {
+        const std::vector<DecodedOp>& ops = block->ops;
+        const size_t count = ops.size();
+        uint8_t* entry = e.p;
+
+        //A chained entry leaves when the block would cross the budget, as RunCodeBlock would.
+        e.Mem(0, true, {0x8d}, RSI, R13, -1, static_cast<int32_t>(block->lead_cycles));   //lea rsi, [r13 + lead]
+        e.Mem(0, true, {0x3b}, RSI, RSP, -1, 0);        //cmp rsi, [rsp]
+        Exit({0x0f, 0x83}, block->start, false);
+
+        std::vector<bool> live(count);
+        bool needed = true;
+        for (size_t i = count; i-- > 0;) {
+            live[i] = needed;
+            const int use = GetFlagUse(ops[i].opcode);
+            if (use != FLAGS_UNUSED)
+                needed = use == FLAGS_READ;
+        }
+
+        uint16_t pc = block->start;
+        uint32_t cycles = 0;
+        for (size_t i = 0; i < count; i++) {
+            const DecodedOp& op = ops[i];
+            const uint16_t next = pc + op.length;
+            if (i + 1 == count && EndsBlock(op.opcode)) {
+                Terminator(op, count, next, cycles);
+                break;
+            }
+
+            cycles += op.cycles;
+            if (!Native(op, i, next, cycles, live[i])) {
+                Helper(op, next);
+                e.LoadGuest();
+                if (StoresToMemory(op.opcode))
+                    CheckValid(i, next, cycles);
+            }
+            if (i + 1 == count) {                       //cut at MAX_BLOCK_OPS, falls through
+                e.AddImmediate(R13, cycles);
+                e.AddImmediate(R15, static_cast<uint32_t>(count));
+                Exit({0xe9}, next);
+            }
+            pc = next;
+        }
+
+        for (const PendingExit& pending : exits) {
+            uint8_t* stub = e.p;
+            e.SetPC(pending.target);
+            e.Patch(e.Jump({0xe9}), exit);
+            e.Patch(pending.site, stub);
+            if (!pending.link || !jit->chain)
+                continue;
+
+            jit->links[pending.target].push_back({pending.site, stub, block->start});
+            jit->linked[block->start].push_back(pending.target);
+            const CodeBlock* target = jit->blocks.blocks[pending.target].get();
+            if (target != nullptr && target->native != nullptr)
+                e.Patch(pending.site, target->native);
+        }
+
+        block->native = entry;
+        for (const JitLink& link : jit->links[block->start])
+            e.Patch(link.site, entry);
+    }
+};
+
+//Drops every translation. Only called between blocks, never while translated code runs.
+static void Flush(JitCache* jit) {
+    for (std::unique_ptr<CodeBlock>& block : jit->blocks.blocks) {
+        if (block)
+            block->native = nullptr;
+    }
+    for (std::vector<JitLink>& links : jit->links)
+        links.clear();
+    for (std::vector<uint16_t>& linked : jit->linked)
+        linked.clear();
+    jit->used = jit->reserved;
+    jit->flushes++;
+}
+
+static void Translate(JitCache* jit, CodeBlock* block) {
+    if (jit->capacity - jit->used < JIT_BLOCK_CODE_SIZE)
+        Flush(jit);
+
+    Translator translator = {jit, block, {jit->code + jit->used, jit->writable - jit->code}, jit->code, {}};
+    translator.Translate();
+    jit->used = translator.e.p - jit->code;
+    jit->translated++;
+}
+
+//The exit trampoline at offset 0 stores the guest registers and counts and returns to RunJitBlock.
+//The entry trampoline at JIT_ENTER_OFFSET is called as a JitEnter and jumps to the translation.
+static void EmitTrampolines(JitCache* jit) {
+    Emitter e = {jit->code, jit->writable - jit->code};
+    e.StoreGuest();
+    e.Mem(0, true, {0x8b}, RSI, RSP, -1, 8);            //mov rsi, [rsp + 8]
+    e.Mem(0, true, {0x89}, R13, RSI, -1, offsetof(JitRun, cycles));
+    e.Mem(0, true, {0x89}, R15, RSI, -1, offsetof(JitRun, instructions));
+    e.Reg(0, true, {0x83}, 0, RSP);                     //add rsp, 24
+    e.Byte(24);
+    for (const int reg : {R15, R14, R13, R12, RBP, RBX}) {
+        e.Rex(false, 0, 0, reg);
+        e.Byte(0x58 + (reg & 7));
+    }
+    e.Byte(0xc3);
+
+    e.p = jit->code + JIT_ENTER_OFFSET;
+    for (const int reg : {RBX, RBP, R12, R13, R14, R15}) {
+        e.Rex(false, 0, 0, reg);
+        e.Byte(0x50 + (reg & 7));
+    }
+    e.Reg(0, true, {0x83}, 5, RSP);                     //sub rsp, 24 keeps calls 16-byte aligned
+    e.Byte(24);
+    e.Mem(0, true, {0x89}, RSI, RSP, -1, 8);            //mov [rsp + 8], rsi
+    e.Reg(0, true, {0x89}, RDI, R12);                   //mov r12, rdi
+    e.Reg(0, true, {0x89}, RDX, R11);                   //mov r11, rdx
+    e.Mem(0, true, {0x8b}, R13, RSI, -1, offsetof(JitRun, cycles));
+    e.Mem(0, true, {0x8b}, R15, RSI, -1, offsetof(JitRun, instructions));
+    e.Mem(0, true, {0x8b}, RAX, RSI, -1, offsetof(JitRun, budget));
+    e.Mem(0, true, {0x89}, RAX, RSP, -1, 0);            //mov [rsp], rax
+    e.Mem(0, true, {0x8b}, R14, RSI, -1, offsetof(JitRun, cover));
+    e.Mem(0, true, {0x8b}, RBP, RSI, -1, offsetof(JitRun, memory));
+    e.LoadGuest();
+    e.Reg(0, false, {0xff}, 4, R11);                    //jmp r11
+
+    jit->reserved = jit->used = e.p - jit->code;
+}
+
+//The code buffer is never writable and executable at once. One memfd is mapped twice: translations
+//run from a readable and executable view and are written through a readable and writable one at
+//another address. Flipping a single mapping with mprotect around every translation and unlink would
+//cost two system calls each, which self-modifying programs pay thousands of times a second.
+JitCache* CreateJitCache() {
+    const int fd = memfd_create("8080_jit", 0);
+    if (fd < 0)
+        return nullptr;
+    void* code = MAP_FAILED;
+    void* writable = MAP_FAILED;
+    if (ftruncate(fd, JIT_CODE_SIZE) == 0) {
+        code = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+        writable = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (code == MAP_FAILED || writable == MAP_FAILED) {
+        if (code != MAP_FAILED)
+            munmap(code, JIT_CODE_SIZE);
+        if (writable != MAP_FAILED)
+            munmap(writable, JIT_CODE_SIZE);
+        return nullptr;
+    }
+
+    JitCache* jit = new JitCache();
+    jit->blocks.jit = jit;
+    jit->code = static_cast<uint8_t*>(code);
+    jit->writable = static_cast<uint8_t*>(writable);
+    jit->capacity = JIT_CODE_SIZE;
+    jit->chain = true;
+    jit->hot_threshold = JIT_HOT_THRESHOLD;
+    EmitTrampolines(jit);
+
+    return jit;
+}
+
+void DestroyJitCache(JitCache* jit) {
+    if (jit == nullptr)
+        return;
+    munmap(jit->code, jit->capacity);
+    munmap(jit->writable, jit->capacity);
+    delete jit;
+}
+
+void UnlinkJitBlock(JitCache* jit, const uint16_t start) {
+    const Emitter e = {nullptr, jit->writable - jit->code};
+    for (const JitLink& link : jit->links[start])
+        e.Patch(link.site, link.stub);
+
+    for (const uint16_t target : jit->linked[start]) {
+        std::vector<JitLink>& links = jit->links[target];
+        links.erase(std::remove_if(links.begin(), links.end(),
+                                   [start](const JitLink& link) { return link.from == start; }),
+                    links.end());
+    }
+    jit->linked[start].clear();
+}
+
+RunResult RunJitBlock(State8080* state, const uint64_t cycle_budget) {
+    JitCache* jit = state->jit;
+    RunResult result = {0, 0};
+
+    if (!jit->blocks.retired.empty())
+        jit->blocks.retired.clear();
+
+    CodeBlock* block = FindBlock(&jit->blocks, state, state->pc);
+    block->executions++;
+    //Idle loops are never translated, so they always come back here to be fast-forwarded.
+    if (block->loop != LOOP_NONE) {
+        RunIdleLoop(state, block, result, cycle_budget);
+        return result;
+    }
+    //Translations load and store straight to state->memory, so behind a memory bus every block is
+    //interpreted.
+    if (block->native == nullptr && block->executions >= jit->hot_threshold && state->memory != nullptr)
+        Translate(jit, block);
+
+    if (block->native == nullptr || block->lead_cycles >= cycle_budget || state->memory == nullptr) {
+        RunCodeBlock(state, block, result, cycle_budget);
+        return result;
+    }
+
+    //Translated code keeps the PSW in AH, so it has to be up to date going in.
+    DefaultFlags::Settle(state);
+    JitRun run = {0, 0, cycle_budget, jit->blocks.cover.data(), state->memory};
+    reinterpret_cast<JitEnter>(jit->code + JIT_ENTER_OFFSET)(state, &run, block->native);
+    result.cycles = run.cycles;
+    result.instructions = run.instructions;
+
+    return result;
+}
+
+#else
+
+JitCache* CreateJitCache() {
+    return nullptr;
+}
+
+void DestroyJitCache(JitCache* jit) {
+    delete jit;
+}
+
+void UnlinkJitBlock(JitCache*, uint16_t) {
+}
+
+RunResult RunJitBlock(State8080* state, const uint64_t cycle_budget) {
+    JitCache* jit = state->jit;
+    RunResult result = {0, 0};
+    const CodeBlock* block = FindBlock(&jit->blocks, state, state->pc);
+    if (block->loop != LOOP_NONE)
+        RunIdleLoop(state, block, result, cycle_budget);
+    else
+        RunCodeBlock(state, block, result, cycle_budget);
+    return result;
+}
+
+#endif
+
+RunResult RunJit(State8080* state, const uint64_t cycle_budget) {
+    RunResult result = {0, 0};
+
+    while (result.cycles < cycle_budget && !state->halted) {
+        const RunResult block = RunJitBlock(state, cycle_budget - result.cycles);
+        result.cycles += block.cycles;
+        result.instructions += block.instructions;
+    }
+    state->jit->blocks.retired.clear();
+
+    return result;
+}
@@ -0,0 +1,56 @@
+#ifndef JIT8080_H
+#define JIT8080_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "blocks8080.h"
+#include "cpu8080.h"
+
+//A jump in translated code that leaves its block for a fixed guest address. It goes to a stub that
+//returns to RunJit while nothing is translated at that address, and straight to the translation
+//once there is one.
+typedef struct JitLink {
+    uint8_t     *site;      //the rel32 field of the jump
+    uint8_t     *stub;
+    uint16_t    from;       //start of the block the jump is in
+} JitLink;
+
+//Translates the hot blocks of a BlockCache to x86-64 code. Blocks that are not hot yet, and blocks
+//that would cross the cycle budget, are still run by the block interpreter, which stays the
+//reference for everything the translations do.
+typedef struct JitCache {
+    BlockCache  blocks;
+    uint8_t     *code;          //mmap'd readable and executable
+    uint8_t     *writable;      //the same memory mapped again, readable and writable
+    size_t      capacity;
+    size_t      used;
+    size_t      reserved;       //the entry and exit trampolines at the start of code
+    std::array<std::vector<JitLink>, 0x10000>  links;  //jumps into each guest address
+    std::array<std::vector<uint16_t>, 0x10000> linked; //guest addresses each translated block jumps to
+    bool        chain;          //jump straight from one translation to the next
+    uint64_t    hot_threshold;  //dispatches of a block before it is translated
+    uint64_t    translated;
+    uint64_t    flushes;        //times the code buffer filled up and every translation was dropped
+} JitCache;
+
+//Returns nullptr when this build or host cannot run translated code (I8080_JIT is off, the host is
+//not x86-64 Linux, or the code buffer cannot be mapped). Attach the cache with state->jit and point
+//state->blocks at its block cache so stores invalidate translations.
+JitCache* CreateJitCache();
+void DestroyJitCache(JitCache* jit);
+
+//Points every jump into the block at start back at its stub and forgets the jumps out of it, whose
+//code is dead. InvalidateBlocks calls this.
+void UnlinkJitBlock(JitCache* jit, uint16_t start);
+
+//Runs the block at pc, translated when it is hot, together with any translations it chains into.
+//Leaves lazy flags pending on return.
+RunResult RunJitBlock(State8080* state, uint64_t cycle_budget);
+
+//Run8080 on a state with a JitCache attached. Leaves lazy flags pending on return.
+RunResult RunJit(State8080* state, uint64_t cycle_budget);
+
+#endif //JIT8080_H
@@ -0,0 +1,413 @@
+#ifndef OPS8080_H
+#define OPS8080_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "cpu8080.h"
+#include "aot8080.h"
+#include "blocks8080.h"
+#include "bus8080.h"
+#include "predecode8080.h"
+
+//Instruction handlers, generated from templates on the operand fields of the opcode. Execute<OP> picks
+//the handler family from the opcode bit pattern and instantiates it with the decoded register, pair,
+//ALU operation or condition as constants, so every one of the 256 handlers is fully specialized.
+
+//Registers in the DDD and SSS fields. M is the byte at HL.
+enum Reg8 : int { REG_B, REG_C, REG_D, REG_E, REG_H, REG_L, REG_M, REG_A };
+
+//Register pairs in the RP field. PUSH and POP use the SP code for PSW.
+enum Reg16 : int { RP_BC, RP_DE, RP_HL, RP_SP };
+
+//ALU operations in bits 3-5 of 0x80-0xbf and of the immediate forms.
+enum AluOp : int { ALU_ADD, ALU_ADC, ALU_SUB, ALU_SBB, ALU_ANA, ALU_XRA, ALU_ORA, ALU_CMP };
+
+//Branch conditions in bits 3-5 of the conditional jumps, calls and returns.
+enum Cond : int { COND_NZ, COND_Z, COND_NC, COND_C, COND_PO, COND_PE, COND_P, COND_M };
+
+//Clock cycles per opcode from the 8080 datasheet. Conditional CALLs and RETs list the
+//not-taken count; the handler adds 6 when the branch is taken.
+inline constexpr uint8_t cycles8080[256] = {
+    4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,     //0x00
+    4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,     //0x10
+    4, 10, 16,  5,  5,  5,  7,  4,  4, 10, 16,  5,  5,  5,  7,  4,     //0x20
+    4, 10, 13,  5, 10, 10, 10,  4,  4, 10, 13,  5,  5,  5,  7,  4,     //0x30
+    5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,     //0x40
+    5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,     //0x50
+    5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,     //0x60
+    7,  7,  7,  7,  7,  7,  7,  7,  5,  5,  5,  5,  5,  5,  7,  5,     //0x70
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0x80
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0x90
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0xa0
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0xb0
+    5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,     //0xc0
+    5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,     //0xd0
+    5, 10, 10, 18, 11, 11,  7, 11,  5,  5, 10,  4, 11, 17,  7, 11,     //0xe0
+    5, 10, 10,  4, 11, 11,  7, 11,  5,  5, 10,  4, 11, 17,  7, 11,     //0xf0
+};
+
+constexpr int InstructionLength(const int op) {
+    if ((op & 0xcf) == 0x01 || op == 0x22 || op == 0x2a || op == 0x32 || op == 0x3a)
+        return 3;   //LXI, SHLD, LHLD, STA, LDA
+    if ((op & 0xc7) == 0xc2 || (op & 0xc7) == 0xc4 || op == 0xc3 || op == 0xcb || (op & 0xcf) == 0xcd)
+        return 3;   //Jcc, Ccc, JMP, CALL and their undocumented aliases
+    if ((op & 0xc7) == 0x06 || (op & 0xc7) == 0xc6 || op == 0xd3 || op == 0xdb)
+        return 2;   //MVI, ALU immediates, OUT, IN
+    return 1;
+}
+
+template <std::size_t... OPS>
+constexpr std::array<uint8_t, 256> MakeLengthTable(std::index_sequence<OPS...>) {
+    return {{static_cast<uint8_t>(InstructionLength(OPS))...}};
+}
+
+//Instruction length in bytes, including the opcode.
+inline constexpr std::array<uint8_t, 256> length8080 = MakeLengthTable(std::make_index_sequence<256>{});
+
+//Flat memory is tested first so that without a bus a read stays one load and a predicted branch.
+inline uint8_t Read8(const State8080* state, const uint16_t address) {
+    if (state->memory != nullptr)
+        return state->memory[address];
+    const uint8_t* page = state->bus->read[address >> 8];
+    return page != nullptr ? page[address & 0xff] : ReadHandler(state, address);
+}
+
+//Whether any attached cache holds code that includes the byte at address.
+inline bool CachedCode(const State8080* state, const uint16_t address) {
+    return (state->predecode != nullptr && state->predecode->cover[address]) ||
+           (state->blocks != nullptr && state->blocks->cover[address]) ||
+           (state->aot != nullptr && state->aot->cover[address]);
+}
+
+inline void InvalidateStore(State8080* state, const uint16_t address) {
+    if (state->predecode != nullptr && state->predecode->cover[address])
+        InvalidateCode(state->predecode, address);
+    if (state->blocks != nullptr && state->blocks->cover[address])
+        InvalidateBlocks(state->blocks, address);
+    if (state->aot != nullptr && state->aot->cover[address])
+        InvalidateAot(state->aot, address);
+}
+
+//Stores handed to a page handler never invalidate cached code or dirty their page: device registers
+//are not code or saved memory, and ROM drops the byte.
+inline void Write8(State8080* state, const uint16_t address, const uint8_t value) {
+    if (state->memory != nullptr) {
+        state->memory[address] = value;
+        state->dirty[address >> 8] = 1;
+    } else {
+        MemoryBus* bus = state->bus;
+        uint8_t* page = bus->write[address >> 8];
+        if (page == nullptr) {
+            WriteHandler(state, address, value);
+            return;
+        }
+        page[address & 0xff] = value;
+        state->dirty[address >> 8] = 1;
+        if (bus->mirror[address >> 8] != address >> 8)
+            InvalidateMirrors(state, address);
+    }
+    InvalidateStore(state, address);
+}
+
+inline uint16_t Read16(const State8080* state, const uint16_t address) {
+    return Read8(state, address) | (Read8(state, address + 1) << 8);
+}
+
+inline void Write16(State8080* state, const uint16_t address, const uint16_t value) {
+    Write8(state, address, value & 0xff);
+    Write8(state, address + 1, value >> 8);
+}
+
+//The 8080 stores the high byte first, at SP-1.
+inline void Push16(State8080* state, const uint16_t value) {
+    Write8(state, state->sp - 1, value >> 8);
+    Write8(state, state->sp - 2, value & 0xff);
+    state->sp -= 2;
+}
+
+inline uint16_t Pop16(State8080* state) {
+    const uint16_t value = Read16(state, state->sp);
+    state->sp += 2;
+    return value;
+}
+
+template <int R>
+inline uint8_t GetReg(const State8080* state) {
+    if constexpr (R == REG_B) return state->b;
+    else if constexpr (R == REG_C) return state->c;
+    else if constexpr (R == REG_D) return state->d;
+    else if constexpr (R == REG_E) return state->e;
+    else if constexpr (R == REG_H) return state->h;
+    else if constexpr (R == REG_L) return state->l;
+    else if constexpr (R == REG_M) return Read8(state, state->hl);
+    else return state->a;
+}
+
+template <int R>
+inline void SetReg(State8080* state, const uint8_t value) {
+    if constexpr (R == REG_B) state->b = value;
+    else if constexpr (R == REG_C) state->c = value;
+    else if constexpr (R == REG_D) state->d = value;
+    else if constexpr (R == REG_E) state->e = value;
+    else if constexpr (R == REG_H) state->h = value;
+    else if constexpr (R == REG_L) state->l = value;
+    else if constexpr (R == REG_M) Write8(state, state->hl, value);
+    else state->a = value;
+}
+
+template <int RP>
+inline uint16_t GetPair(const State8080* state) {
+    if constexpr (RP == RP_BC) return state->bc;
+    else if constexpr (RP == RP_DE) return state->de;
+    else if constexpr (RP == RP_HL) return state->hl;
+    else return state->sp;
+}
+
+template <int RP>
+inline void SetPair(State8080* state, const uint16_t value) {
+    if constexpr (RP == RP_BC) state->bc = value;
+    else if constexpr (RP == RP_DE) state->de = value;
+    else if constexpr (RP == RP_HL) state->hl = value;
+    else state->sp = value;
+}
+
+template <int C, typename Flags>
+inline bool Condition(State8080* state) {
+    const ConditionCodes& cc = Flags::Settled(state);
+    if constexpr (C == COND_NZ) return !cc.z();
+    else if constexpr (C == COND_Z) return cc.z();
+    else if constexpr (C == COND_NC) return !cc.cy();
+    else if constexpr (C == COND_C) return cc.cy();
+    else if constexpr (C == COND_PO) return !cc.p();
+    else if constexpr (C == COND_PE) return cc.p();
+    else if constexpr (C == COND_P) return !cc.s();
+    else return cc.s();
+}
+
+template <int OPER, typename Flags>
+inline void Alu(State8080* state, const uint8_t value) {
+    const uint8_t a = state->a;
+    if constexpr (OPER == ALU_ADD || OPER == ALU_ADC) {
+        uint16_t answer = static_cast<uint16_t>(a) + value;
+        if constexpr (OPER == ALU_ADC) answer += Flags::Carry(state);
+        Flags::Add(state, a, value, answer);
+        state->a = answer & 0xff;
+    } else if constexpr (OPER == ALU_SUB || OPER == ALU_SBB || OPER == ALU_CMP) {
+        uint16_t answer = static_cast<uint16_t>(a) - value;
+        if constexpr (OPER == ALU_SBB) answer -= Flags::Carry(state);
+        Flags::Sub(state, a, value, answer);
+        if constexpr (OPER != ALU_CMP) state->a = answer & 0xff;
+    } else if constexpr (OPER == ALU_ANA) {
+        state->a = a & value;
+        Flags::And(state, a, value, state->a);
+    } else if constexpr (OPER == ALU_XRA) {
+        state->a = a ^ value;
+        Flags::Logic(state, state->a);
+    } else {
+        state->a = a | value;
+        Flags::Logic(state, state->a);
+    }
+}
+
+template <int OP>
+inline constexpr bool dependent_false = false;
+
+//Executes opcode OP. state->pc already points at the next instruction and operand holds the immediate
+//byte or word that followed the opcode. Returns the cycles taken.
+template <int OP, typename Flags>
+inline int Execute(State8080* state, const uint16_t operand) {
+    constexpr int DDD = (OP >> 3) & 7;
+    constexpr int SSS = OP & 7;
+    constexpr int RP = (OP >> 4) & 3;
+    int cycles = cycles8080[OP];
+
+    if constexpr (OP == 0x76) {                         //HLT
+        state->halted = 1;
+    } else if constexpr ((OP & 0xc0) == 0x40) {         //MOV
+        SetReg<DDD>(state, GetReg<SSS>(state));
+    } else if constexpr ((OP & 0xc0) == 0x80) {         //ADD ADC SUB SBB ANA XRA ORA CMP
+        Alu<DDD, Flags>(state, GetReg<SSS>(state));
+    } else if constexpr ((OP & 0xc7) == 0xc6) {         //ADI ACI SUI SBI ANI XRI ORI CPI
+        Alu<DDD, Flags>(state, operand & 0xff);
+    } else if constexpr ((OP & 0xc7) == 0x00) {         //NOP and its undocumented aliases
+    } else if constexpr ((OP & 0xc7) == 0x04) {         //INR
+        const uint8_t result = GetReg<DDD>(state) + 1;
+        Flags::Inc(state, result);
+        SetReg<DDD>(state, result);
+    } else if constexpr ((OP & 0xc7) == 0x05) {         //DCR
+        const uint8_t result = GetReg<DDD>(state) - 1;
+        Flags::Dec(state, result);
+        SetReg<DDD>(state, result);
+    } else if constexpr ((OP & 0xc7) == 0x06) {         //MVI
+        SetReg<DDD>(state, operand & 0xff);
+    } else if constexpr ((OP & 0xcf) == 0x01) {         //LXI
+        SetPair<RP>(state, operand);
+    } else if constexpr ((OP & 0xcf) == 0x03) {         //INX
+        SetPair<RP>(state, GetPair<RP>(state) + 1);
+    } else if constexpr ((OP & 0xcf) == 0x0b) {         //DCX
+        SetPair<RP>(state, GetPair<RP>(state) - 1);
+    } else if constexpr ((OP & 0xcf) == 0x09) {         //DAD
+        const uint32_t sum = static_cast<uint32_t>(state->hl) + GetPair<RP>(state);
+        Flags::Settle(state);
+        state->cc.set_cy(sum > 0xffff);
+        state->hl = sum & 0xffff;
+    } else if constexpr (OP == 0x02 || OP == 0x12) {    //STAX
+        Write8(state, GetPair<RP>(state), state->a);
+    } else if constexpr (OP == 0x0a || OP == 0x1a) {    //LDAX
+        state->a = Read8(state, GetPair<RP>(state));
+    } else if constexpr (OP == 0x22) {                  //SHLD
+        Write16(state, operand, state->hl);
+    } else if constexpr (OP == 0x2a) {                  //LHLD
+        state->hl = Read16(state, operand);
+    } else if constexpr (OP == 0x32) {                  //STA
+        Write8(state, operand, state->a);
+    } else if constexpr (OP == 0x3a) {                  //LDA
+        state->a = Read8(state, operand);
+    } else if constexpr (OP == 0x07) {                  //RLC
+        Flags::Settle(state);
+        state->cc.set_cy(state->a >> 7);
+        state->a = (state->a << 1) | (state->a >> 7);
+    } else if constexpr (OP == 0x0f) {                  //RRC
+        Flags::Settle(state);
+        state->cc.set_cy(state->a & 1);
+        state->a = (state->a >> 1) | (state->a << 7);
+    } else if constexpr (OP == 0x17) {                  //RAL
+        const uint8_t carry = Flags::Settled(state).cy();
+        state->cc.set_cy(state->a >> 7);
+        state->a = (state->a << 1) | carry;
+    } else if constexpr (OP == 0x1f) {                  //RAR
+        const uint8_t carry = Flags::Settled(state).cy();
+        state->cc.set_cy(state->a & 1);
+        state->a = (state->a >> 1) | (carry << 7);
+    } else if constexpr (OP == 0x27) {                  //DAA
+        const ConditionCodes& cc = Flags::Settled(state);
+        const uint8_t a = state->a;
+        uint8_t correction = 0;
+        bool carry = cc.cy();
+        if ((a & 0x0f) > 9 || cc.ac())
+            correction |= 0x06;
+        if (a > 0x99 || carry) {
+            correction |= 0x60;
+            carry = true;
+        }
+        state->a = a + correction;
+        state->cc.psw = zsp_table[state->a] | AuxCarryAdd(a, correction, state->a) | (carry ? FLAG_CY : 0) |
+                        PSW_FIXED;
+    } else if constexpr (OP == 0x2f) {                  //CMA
+        state->a = ~state->a;
+    } else if constexpr (OP == 0x37) {                  //STC
+        Flags::Settled(state).psw |= FLAG_CY;
+    } else if constexpr (OP == 0x3f) {                  //CMC
+        Flags::Settled(state).psw ^= FLAG_CY;
+    } else if constexpr (OP == 0xf1) {                  //POP PSW
+        const uint16_t value = Pop16(state);
+        Flags::Load(state, (value & PSW_FLAGS) | PSW_FIXED);
+        state->a = value >> 8;
+    } else if constexpr ((OP & 0xcf) == 0xc1) {         //POP
+        SetPair<RP>(state, Pop16(state));
+    } else if constexpr (OP == 0xf5) {                  //PUSH PSW
+        const uint8_t psw = Flags::Settled(state).psw | PSW_FIXED;
+        Push16(state, (state->a << 8) | psw);
+    } else if constexpr ((OP & 0xcf) == 0xc5) {         //PUSH
+        Push16(state, GetPair<RP>(state));
+    } else if constexpr ((OP & 0xc7) == 0xc0) {         //Rcc
+        if (Condition<DDD, Flags>(state)) {
+            state->pc = Pop16(state);
+            cycles += 6;
+        }
+    } else if constexpr (OP == 0xc9 || OP == 0xd9) {    //RET
+        state->pc = Pop16(state);
+    } else if constexpr ((OP & 0xc7) == 0xc2) {         //Jcc
+        if (Condition<DDD, Flags>(state))
+            state->pc = operand;
+    } else if constexpr (OP == 0xc3 || OP == 0xcb) {    //JMP
+        state->pc = operand;
+    } else if constexpr ((OP & 0xc7) == 0xc4) {         //Ccc
+        if (Condition<DDD, Flags>(state)) {
+            Push16(state, state->pc);
+            state->pc = operand;
+            cycles += 6;
+        }
+    } else if constexpr ((OP & 0xcf) == 0xcd) {         //CALL
+        Push16(state, state->pc);
+        state->pc = operand;
+    } else if constexpr ((OP & 0xc7) == 0xc7) {         //RST
+        Push16(state, state->pc);
+        state->pc = OP & 0x38;
+    } else if constexpr (OP == 0xd3) {                  //OUT
+        if (state->port_out)
+            state->port_out(state, operand & 0xff, state->a);
+    } else if constexpr (OP == 0xdb) {                  //IN
+        state->a = state->port_in ? state->port_in(state, operand & 0xff) : 0;
+    } else if constexpr (OP == 0xe3) {                  //XTHL
+        const uint16_t top = Read16(state, state->sp);
+        Write16(state, state->sp, state->hl);
+        state->hl = top;
+    } else if constexpr (OP == 0xe9) {                  //PCHL
+        state->pc = state->hl;
+    } else if constexpr (OP == 0xeb) {                  //XCHG
+        const uint16_t de = state->de;
+        state->de = state->hl;
+        state->hl = de;
+    } else if constexpr (OP == 0xf3) {                  //DI
+        state->int_enable = 0;
+    } else if constexpr (OP == 0xf9) {                  //SPHL
+        state->sp = state->hl;
+    } else if constexpr (OP == 0xfb) {                  //EI
+        state->int_enable = 1;
+    } else {
+        static_assert(dependent_false<OP>, "opcode not decoded");
+    }
+
+    return cycles;
+}
+
+//Fetches the operand of opcode OP at state->pc, moves pc past the instruction and executes it.
+template <int OP, typename Flags>
+inline int Step(State8080* state) {
+    constexpr int length = length8080[OP];
+    uint16_t operand = 0;
+    if constexpr (length == 2)
+        operand = Read8(state, state->pc + 1);
+    else if constexpr (length == 3)
+        operand = Read16(state, state->pc + 1);
+    state->pc += length;
+    return Execute<OP, Flags>(state, operand);
+}
+
+typedef int (*StepHandler)(State8080* state);
+
+template <typename Flags, std::size_t... OPS>
+constexpr std::array<StepHandler, 256> MakeStepTable(std::index_sequence<OPS...>) {
+    return {{&Step<OPS, Flags>...}};
+}
+
+//One fully specialized handler per opcode.
+template <typename Flags>
+inline constexpr std::array<StepHandler, 256> step_table = MakeStepTable<Flags>(std::make_index_sequence<256>{});
+
+//Threaded dispatch gives every handler its own indirect jump to the next one through a table of
+//label addresses, which the branch predictor tracks far better than the switch's single shared
+//jump. It needs the GCC/Clang labels-as-values extension, so other compilers keep the switch.
+#if defined(I8080_THREADED_DISPATCH) && defined(__GNUC__)
+#define THREADED_DISPATCH 1
+#else
+#define THREADED_DISPATCH 0
+#endif
+
+//Expands X(0x00) through X(0xff), once per opcode, to build the dispatch loops.
+#define OPCODE_ROW(X, h) X(h##0) X(h##1) X(h##2) X(h##3) X(h##4) X(h##5) X(h##6) X(h##7) \
+                         X(h##8) X(h##9) X(h##a) X(h##b) X(h##c) X(h##d) X(h##e) X(h##f)
+#define OPCODE_LIST(X) OPCODE_ROW(X, 0x0) OPCODE_ROW(X, 0x1) OPCODE_ROW(X, 0x2) OPCODE_ROW(X, 0x3) \
+                       OPCODE_ROW(X, 0x4) OPCODE_ROW(X, 0x5) OPCODE_ROW(X, 0x6) OPCODE_ROW(X, 0x7) \
+                       OPCODE_ROW(X, 0x8) OPCODE_ROW(X, 0x9) OPCODE_ROW(X, 0xa) OPCODE_ROW(X, 0xb) \
+                       OPCODE_ROW(X, 0xc) OPCODE_ROW(X, 0xd) OPCODE_ROW(X, 0xe) OPCODE_ROW(X, 0xf)
+
+#if THREADED_DISPATCH
+#define OPCODE_ADDRESS(n) &&op_##n,
+#endif
+
+#endif //OPS8080_H
@@ -0,0 +1,241 @@
+#include <cstring>
+
+#include "predecode8080.h"
+#include "ops8080.h"
+
+void InvalidateCode(PredecodeCache* cache, const uint16_t address) {
+    //An instruction is at most three bytes long, so only the two before address can reach it.
+    for (int back = 0; back < 3; back++) {
+        const uint16_t start = address - back;
+        DecodedOp& op = cache->ops[start];
+        if (op.length <= back)
+            continue;
+
+        for (int i = 0; i < op.length; i++)
+            cache->cover[static_cast<uint16_t>(start + i)]--;
+        op.length = 0;
+        cache->invalidations++;
+    }
+}
+
+DecodedOp Decode(const State8080* state, const uint16_t address) {
+    DecodedOp op;
+    op.opcode = Read8(state, address);
+    op.length = length8080[op.opcode];
+    op.cycles = cycles8080[op.opcode];
+    op.fused = FUSE_NONE;
+    op.operand = 0;
+    if (op.length == 2)
+        op.operand = Read8(state, address + 1);
+    else if (op.length == 3)
+        op.operand = Read16(state, address + 1);
+
+    return op;
+}
+
+constexpr bool FusionsFallThrough() {
+    for (int f = 1; f < FUSION_COUNT; f++) {
+        for (int i = 0; i < (fusion_ops[f][2] < 0 ? 1 : 2); i++) {
+            const int op = fusion_ops[f][i];
+            if (EndsBlock(op) || op == 0xd3 || op == 0xdb)
+                return false;
+        }
+    }
+    return true;
+}
+static_assert(FusionsFallThrough(), "only the last instruction of a fusion may change pc, halt or call a port");
+
+//Bit f of entry n is set when Fusion f starts with opcode n.
+static constexpr std::array<uint32_t, 256> MakeFusionStarts() {
+    std::array<uint32_t, 256> starts = {};
+    for (int f = 1; f < FUSION_COUNT; f++)
+        starts[fusion_ops[f][0]] |= 1u << f;
+    return starts;
+}
+static constexpr std::array<uint32_t, 256> fusion_starts = MakeFusionStarts();
+
+//The first enabled fusion whose opcodes are the ones in memory at address, whose opcode is first.
+static uint8_t MatchFusion(const PredecodeCache* cache, const State8080* state, const uint16_t address,
+                           const uint8_t first) {
+    if ((fusion_starts[first] & cache->fusions) == 0)
+        return FUSE_NONE;
+    for (int f = 1; f < FUSION_COUNT; f++) {
+        if (!(cache->fusions & (1u << f)) || fusion_ops[f][0] != first)
+            continue;
+
+        uint16_t next = address + length8080[first];
+        bool matches = true;
+        for (int i = 1; i < 3 && matches && fusion_ops[f][i] >= 0; i++) {
+            const uint8_t opcode = Read8(state, next);
+            matches = opcode == fusion_ops[f][i];
+            next += length8080[opcode];
+        }
+        if (matches)
+            return static_cast<uint8_t>(f);
+    }
+    return FUSE_NONE;
+}
+
+const DecodedOp& DecodeAt(PredecodeCache* cache, const State8080* state, const uint16_t address) {
+    DecodedOp& op = cache->ops[address];
+    op = Decode(state, address);
+    if (cache->fusions != 0)
+        op.fused = MatchFusion(cache, state, address, op.opcode);
+
+    for (int i = 0; i < op.length; i++)
+        cache->cover[static_cast<uint16_t>(address + i)]++;
+    cache->decodes++;
+
+    return op;
+}
+
+inline const DecodedOp& Fetch(PredecodeCache* cache, const State8080* state) {
+    const DecodedOp& op = cache->ops[state->pc];
+    return op.length != 0 ? op : DecodeAt(cache, state, state->pc);
+}
+
+//The dispatch index of a cached instruction. A fusion gets its own row of 256 above the opcodes, with
+//its handler at the column of its first opcode, so picking it costs no branch.
+inline int Handler(const DecodedOp& op) {
+    return op.opcode | (op.fused << 8);
+}
+
+constexpr int HANDLERS = 256 * FUSION_COUNT;
+
+//Stands in for the missing third opcode of a pair, so the code that would run it still compiles.
+#define FUSED_OP(n) ((n) >= 0 ? (n) : 0)
+
+//Same loops as RunCore, but the opcode and operand come from the cache instead of memory. The handler
+//may store over its own entry, so the operand is copied out before it runs.
+#if THREADED_DISPATCH
+#define STEP(n)                                                         \
+        state->pc += length8080[n];                                     \
+        result.cycles += Execute<n, DefaultFlags>(state, operand);      \
+        result.instructions++;                                          \
+        if (result.cycles >= cycle_budget || state->halted)             \
+            return result;                                              \
+        op = &Fetch(cache, state);                                      \
+        operand = op->operand;
+
+#define OPCODE(n)                                                       \
+    op_##n:                                                             \
+        STEP(n)                                                         \
+        goto *dispatch_table[Handler(*op)];
+
+//Whether op holds a decoded N. A decoded entry always has the length of its opcode, so opcode and length
+//are compared as one 2-byte word rather than testing length for 0 first, a second branch that cost
+//tight fused loops more than the dispatch the fusion saves.
+template <int N>
+inline bool Holds(const DecodedOp& op) {
+    static constexpr uint8_t decoded[2] = {N, length8080[N]};
+    return std::memcmp(&op.opcode, decoded, 2) == 0;
+}
+
+//STEP for an instruction of a fusion that is followed by next. It cannot halt, so only the budget is
+//checked, and the entry that follows is used as it is when it holds next.
+#define FUSED_STEP(n, next)                                             \
+        state->pc += length8080[n];                                     \
+        result.cycles += Execute<n, DefaultFlags>(state, operand);      \
+        result.instructions++;                                          \
+        if (result.cycles >= cycle_budget)                              \
+            return result;                                              \
+        op = &cache->ops[state->pc];                                    \
+        operand = op->operand;                                          \
+        if (!Holds<next>(*op))                                          \
+            goto fusion_broken;
+
+//Runs the first instruction, then each of the others as long as the cache still holds it next.
+#define FUSION(name, a, b, c)                                           \
+    fuse_##name:                                                        \
+        FUSED_STEP(a, b)                                                \
+        if ((c) >= 0) {                                                 \
+            FUSED_STEP(b, FUSED_OP(c))                                  \
+            cache->fused[FUSE_##name]++;                                \
+            STEP(FUSED_OP(c))                                           \
+        } else {                                                        \
+            cache->fused[FUSE_##name]++;                                \
+            STEP(b)                                                     \
+        }                                                               \
+        goto *dispatch_table[Handler(*op)];
+
+#define FUSION_ADDRESS(name, a, b, c) &&fuse_##name,
+
+typedef std::array<const void*, HANDLERS> DispatchTable;
+
+static DispatchTable MakeDispatchTable(const void* const* opcodes, const void* const* fusions) {
+    DispatchTable table = {};
+    for (int n = 0; n < 256; n++)
+        table[n] = opcodes[n];
+    for (int f = 1; f < FUSION_COUNT; f++)
+        table[(f << 8) | fusion_ops[f][0]] = fusions[f - 1];
+    return table;
+}
+#else
+#define OPCODE(n)                                                       \
+    case n:                                                             \
+        state->pc += length8080[n];                                     \
+        result.cycles += Execute<n, DefaultFlags>(state, operand);      \
+        break;
+
+#define FUSION(name, a, b, c)                                           \
+    case (FUSE_##name << 8) | (a):                                      \
+        state->pc += length8080[a];                                     \
+        result.cycles += Execute<a, DefaultFlags>(state, operand);      \
+        if (FusedStep<b>(state, cache, result, cycle_budget) &&         \
+            ((c) < 0 || FusedStep<FUSED_OP(c)>(state, cache, result, cycle_budget))) \
+            cache->fused[FUSE_##name]++;                                \
+        break;
+
+//Runs the next instruction of a fusion if the budget allows and it is the one expected, counting the
+//instruction before it. The loop counts the last one that ran.
+template <int N>
+inline bool FusedStep(State8080* state, PredecodeCache* cache, RunResult& result, const uint64_t cycle_budget) {
+    if (result.cycles >= cycle_budget || state->halted)
+        return false;
+    const DecodedOp& op = Fetch(cache, state);
+    if (op.opcode != N)
+        return false;
+
+    result.instructions++;
+    const uint16_t operand = op.operand;
+    state->pc += length8080[N];
+    result.cycles += Execute<N, DefaultFlags>(state, operand);
+    return true;
+}
+#endif
+
+RunResult RunPredecoded(State8080* state, const uint64_t cycle_budget) {
+    PredecodeCache* cache = state->predecode;
+    RunResult result = {0, 0};
+
+#if THREADED_DISPATCH
+    static const void* const opcode_labels[256] = {OPCODE_LIST(OPCODE_ADDRESS)};
+    static const void* const fusion_labels[FUSION_COUNT - 1] = {FUSION_LIST(FUSION_ADDRESS)};
+    static const DispatchTable dispatch_table = MakeDispatchTable(opcode_labels, fusion_labels);
+
+    if (result.cycles >= cycle_budget || state->halted)
+        return result;
+    const DecodedOp* op = &Fetch(cache, state);
+    uint16_t operand = op->operand;
+    goto *dispatch_table[Handler(*op)];
+    OPCODE_LIST(OPCODE)
+    FUSION_LIST(FUSION)
+
+fusion_broken:
+    op = &Fetch(cache, state);
+    operand = op->operand;
+    goto *dispatch_table[Handler(*op)];
+#else
+    while (result.cycles < cycle_budget && !state->halted) {
+        const DecodedOp& op = Fetch(cache, state);
+        const uint16_t operand = op.operand;
+        switch (Handler(op)) {
+            OPCODE_LIST(OPCODE)
+            FUSION_LIST(FUSION)
+        }
+        result.instructions++;
+    }
+
+    return result;
+#endif
+}
@@ -0,0 +1,90 @@
+#ifndef PREDECODE8080_H
+#define PREDECODE8080_H
+
+#include <array>
+#include <cstdint>
+
+#include "cpu8080.h"
+
+//Opcode sequences RunPredecoded dispatches as one superinstruction. The handler of the first runs
+//the others straight after it, checking only that the next cached opcode is the one it expects and
+//that the budget is not used up, instead of going back through the dispatch table each time. Every
+//instruction but the last has to fall through. A third opcode of -1 means a pair.
+#define FUSION_LIST(X)                          \
+    X(DCR_B_JNZ,            0x05, 0xc2, -1)     \
+    X(DCR_C_JNZ,            0x0d, 0xc2, -1)     \
+    X(DCR_D_JNZ,            0x15, 0xc2, -1)     \
+    X(DCR_E_JNZ,            0x1d, 0xc2, -1)     \
+    X(DCR_A_JNZ,            0x3d, 0xc2, -1)     \
+    X(MOV_A_M_INX_H,        0x7e, 0x23, -1)     \
+    X(MOV_M_A_INX_H,        0x77, 0x23, -1)     \
+    X(LDAX_D_STAX_B,        0x1a, 0x02, -1)     \
+    X(LDAX_B_STAX_D,        0x0a, 0x12, -1)     \
+    X(LDAX_D_MOV_M_A,       0x1a, 0x77, -1)     \
+    X(CPI_JZ,               0xfe, 0xca, -1)     \
+    X(CPI_JNZ,              0xfe, 0xc2, -1)     \
+    X(CPI_JC,               0xfe, 0xda, -1)     \
+    X(CPI_JNC,              0xfe, 0xd2, -1)     \
+    X(ANA_A_JZ,             0xa7, 0xca, -1)     \
+    X(ORA_A_JNZ,            0xb7, 0xc2, -1)     \
+    X(PUSH_H_POP_D,         0xe5, 0xd1, -1)     \
+    X(PUSH_D_POP_H,         0xd5, 0xe1, -1)     \
+    X(DCX_B_MOV_A_B_ORA_C,  0x0b, 0x78, 0xb1)   \
+    X(DCX_D_MOV_A_D_ORA_E,  0x1b, 0x7a, 0xb3)
+
+#define FUSION_ENUM(name, a, b, c) FUSE_##name,
+enum Fusion : uint8_t {
+    FUSE_NONE,
+    FUSION_LIST(FUSION_ENUM)
+    FUSION_COUNT
+};
+#undef FUSION_ENUM
+
+#define FUSION_NAME(name, a, b, c) #name,
+inline constexpr const char* fusion_names[FUSION_COUNT] = {"", FUSION_LIST(FUSION_NAME)};
+#undef FUSION_NAME
+
+#define FUSION_OPS(name, a, b, c) {a, b, c},
+inline constexpr int fusion_ops[FUSION_COUNT][3] = {{-1, -1, -1}, FUSION_LIST(FUSION_OPS)};
+#undef FUSION_OPS
+
+//Enables every fusion in PredecodeCache::fusions.
+constexpr uint32_t ALL_FUSIONS = ((1u << FUSION_COUNT) - 1) & ~1u;
+static_assert(FUSION_COUNT <= 32, "PredecodeCache::fusions has a bit per fusion");
+
+//One decoded instruction, cached at the address of its opcode.
+typedef struct DecodedOp {
+    uint16_t    operand;    //the immediate byte or word that follows the opcode
+    uint8_t     opcode;     //selects the handler
+    uint8_t     length;     //0 until the instruction at this address has been decoded
+    uint8_t     cycles;     //not-taken count, the handler returns 6 more for a taken CALL or RET
+    uint8_t     fused;      //the Fusion that starts here, only ever set by DecodeAt
+} DecodedOp;
+
+//A decoded instruction for every address in the 64K space. cover counts the decoded instructions
+//that include each byte, so a store only has to look at one byte to know if it hit cached code.
+//A fusion only covers its first instruction; its handler checks the others as it reaches them, so
+//a store that changes them just makes it fall back to normal dispatch.
+typedef struct PredecodeCache {
+    std::array<DecodedOp, 0x10000>  ops;
+    std::array<uint8_t, 0x10000>    cover;
+    uint32_t    fusions;    //bit f enables Fusion f, 0 runs every instruction on its own
+    uint64_t    decodes;
+    uint64_t    invalidations;
+    std::array<uint64_t, FUSION_COUNT>  fused;  //times each fusion ran all of its instructions
+} PredecodeCache;
+
+//Drops every cached instruction that includes address. Write8 calls this for stores into cached code,
+//so self-modifying code is decoded again the next time it runs.
+void InvalidateCode(PredecodeCache* cache, uint16_t address);
+
+//Decodes the instruction at address without caching it.
+DecodedOp Decode(const State8080* state, uint16_t address);
+
+//Decodes the instruction at address into the cache and returns its entry.
+const DecodedOp& DecodeAt(PredecodeCache* cache, const State8080* state, uint16_t address);
+
+//Run8080 on a state with a predecode cache attached. Leaves lazy flags pending on return.
+RunResult RunPredecoded(State8080* state, uint64_t cycle_budget);
+
+#endif //PREDECODE8080_H
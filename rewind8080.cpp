@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "rewind8080.h"
+#include "ops8080.h"
+#include "savestate8080.h"
+#include "snapshot8080.h"
+
+//The registers in a delta, in SaveState's order: a, b, c, d, e, h, l, psw, int_enable, halted, sp, pc.
+constexpr size_t REGISTER_BYTES = 14;
+
+RewindBuffer* CreateRewindBuffer(const size_t capacity, const uint64_t keyframe_cycles, const uint64_t frame_cycles) {
+    if (capacity < REWIND_MIN_CAPACITY)
+        return nullptr;
+    RewindBuffer* rewind = new (std::nothrow) RewindBuffer();
+    if (rewind == nullptr)
+        return nullptr;
+    try {
+        rewind->ring.resize(capacity);
+    } catch (const std::bad_alloc&) {
+        delete rewind;
+        return nullptr;
+    }
+    rewind->keyframe_cycles = std::max<uint64_t>(keyframe_cycles, 1);
+    rewind->frame_cycles = std::max<uint64_t>(frame_cycles, 1);
+    return rewind;
+}
+
+void DestroyRewindBuffer(RewindBuffer* rewind) {
+    delete rewind;
+}
+
+//Copies the memory of state into the shadow, page by page as HostPage sees it.
+static void ShadowMemory(RewindBuffer* rewind, const State8080* state) {
+    for (int page = 0; page < 256; page++) {
+        const uint8_t* host = HostPage(state, page);
+        if (host != nullptr)
+            std::memcpy(&rewind->shadow[page * DIRTY_PAGE_SIZE], host, DIRTY_PAGE_SIZE);
+    }
+}
+
+//Appends, for each page in the dirty map that changed since the shadow was taken, the page number
+//and the XOR of its old and new bytes as pairs of a count of zeroes to skip and a count of bytes that
+//follow, then brings the shadow up to date. Returns the number of pages.
+static uint16_t EncodePages(RewindBuffer* rewind, const State8080* state, std::vector<uint8_t>* out) {
+    uint16_t pages = 0;
+    for (int page = 0; page < 256; page++) {
+        const uint8_t* host = HostPage(state, page);
+        uint8_t* shadow = &rewind->shadow[page * DIRTY_PAGE_SIZE];
+        if (!state->dirty[page] || host == nullptr || std::memcmp(host, shadow, DIRTY_PAGE_SIZE) == 0)
+            continue;
+
+        out->push_back(static_cast<uint8_t>(page));
+        for (int i = 0; i < DIRTY_PAGE_SIZE;) {
+            int skip = 0;
+            while (i + skip < DIRTY_PAGE_SIZE && skip < 255 && host[i + skip] == shadow[i + skip])
+                skip++;
+            i += skip;
+            //A single equal byte is cheaper to carry along than to end the run for.
+            int count = 0;
+            while (i + count < DIRTY_PAGE_SIZE && count < 255 &&
+                   (host[i + count] != shadow[i + count] ||
+                    (i + count + 1 < DIRTY_PAGE_SIZE && host[i + count + 1] != shadow[i + count + 1])))
+                count++;
+            out->push_back(static_cast<uint8_t>(skip));
+            out->push_back(static_cast<uint8_t>(count));
+            for (int j = i; j < i + count; j++)
+                out->push_back(host[j] ^ shadow[j]);
+            i += count;
+        }
+        std::memcpy(shadow, host, DIRTY_PAGE_SIZE);
+        pages++;
+    }
+    return pages;
+}
+
+//Stores the frame in scratch at the head of the ring, first dropping the frames it would overwrite
+//and any deltas left without their keyframe. A frame larger than the whole ring is not kept.
+static void Append(RewindBuffer* rewind, const bool keyframe) {
+    const size_t size = rewind->scratch.size();
+    if (size > rewind->ring.size())
+        return;
+    if (rewind->head + size > rewind->ring.size()) {
+        //The frames past the head are the oldest, and wrapping leaves them behind.
+        while (!rewind->frames.empty() && rewind->frames.front().offset >= rewind->head)
+            rewind->frames.pop_front();
+        rewind->head = 0;
+        rewind->wraps++;
+    }
+    while (!rewind->frames.empty() && rewind->frames.front().offset < rewind->head + size &&
+           rewind->frames.front().offset + rewind->frames.front().size > rewind->head)
+        rewind->frames.pop_front();
+    while (!rewind->frames.empty() && !rewind->frames.front().keyframe)
+        rewind->frames.pop_front();
+    if (!keyframe && rewind->frames.empty())
+        return;
+
+    std::memcpy(&rewind->ring[rewind->head], rewind->scratch.data(), size);
+    rewind->frames.push_back({rewind->head, size, rewind->cycles, keyframe});
+    rewind->head += size;
+}
+
+//Clears the pages of state->dirty the frame just taken covers, keeping them to give back later.
+static void TakeDirtyPages(RewindBuffer* rewind, State8080* state) {
+    for (int page = 0; page < 256; page++) {
+        rewind->taken[page] |= state->dirty[page];
+        state->dirty[page] = 0;
+    }
+}
+
+static void GiveBackDirtyPages(RewindBuffer* rewind, State8080* state) {
+    for (int page = 0; page < 256; page++)
+        state->dirty[page] |= rewind->taken[page];
+    rewind->taken.fill(0);
+}
+
+static void Capture(RewindBuffer* rewind, State8080* state) {
+    std::vector<uint8_t>& out = rewind->scratch;
+    out.clear();
+    const bool keyframe = rewind->frames.empty() || rewind->cycles >= rewind->next_keyframe;
+    if (keyframe) {
+        SaveState(state, rewind->cycles, nullptr, {}, &out);
+        ShadowMemory(rewind, state);
+        rewind->next_keyframe = rewind->cycles + rewind->keyframe_cycles;
+        rewind->keyframes++;
+    } else {
+        State8080 settled = *state;
+        DefaultFlags::Settle(&settled);
+        out.insert(out.end(), {settled.a, settled.b, settled.c, settled.d, settled.e, settled.h, settled.l,
+                               settled.cc.psw, settled.int_enable, settled.halted, static_cast<uint8_t>(settled.sp),
+                               static_cast<uint8_t>(settled.sp >> 8), static_cast<uint8_t>(settled.pc),
+                               static_cast<uint8_t>(settled.pc >> 8), 0, 0});
+        const uint16_t pages = EncodePages(rewind, state, &out);
+        out[REGISTER_BYTES] = pages & 0xff;
+        out[REGISTER_BYTES + 1] = pages >> 8;
+        rewind->deltas++;
+    }
+    TakeDirtyPages(rewind, state);
+    rewind->next_frame = rewind->cycles + rewind->frame_cycles;
+    Append(rewind, keyframe);
+}
+
+RunResult RunRewound(RewindBuffer* rewind, State8080* state, const uint64_t cycle_budget) {
+    if (rewind->frames.empty())
+        Capture(rewind, state);
+
+    RunResult total = {0, 0};
+    while (total.cycles < cycle_budget) {
+        const uint64_t slice = std::min(cycle_budget - total.cycles, rewind->next_frame - rewind->cycles);
+        const RunResult result = Run8080(state, slice);
+        total.cycles += result.cycles;
+        total.instructions += result.instructions;
+        rewind->cycles += result.cycles;
+        if (rewind->cycles >= rewind->next_frame)
+            Capture(rewind, state);
+    }
+    GiveBackDirtyPages(rewind, state);
+    return total;
+}
+
+//XORs the page deltas of the frame at data into the memory of state, then sets its registers.
+static void ApplyDelta(State8080* state, const uint8_t* data) {
+    const uint8_t* at = data + REGISTER_BYTES + 2;
+    const int pages = data[REGISTER_BYTES] | data[REGISTER_BYTES + 1] << 8;
+    for (int n = 0; n < pages; n++) {
+        const int page = *at++;
+        const uint8_t* host = HostPage(state, page);
+        uint8_t bytes[DIRTY_PAGE_SIZE];
+        std::memcpy(bytes, host, DIRTY_PAGE_SIZE);
+        for (int i = 0; i < DIRTY_PAGE_SIZE;) {
+            i += *at++;
+            const int count = *at++;
+            for (int j = i; j < i + count; j++)
+                bytes[j] ^= *at++;
+            i += count;
+        }
+        StorePage(state, page, bytes);
+    }
+
+    state->a = data[0];
+    state->b = data[1];
+    state->c = data[2];
+    state->d = data[3];
+    state->e = data[4];
+    state->h = data[5];
+    state->l = data[6];
+    state->cc.psw = (data[7] & PSW_FLAGS) | PSW_FIXED;
+    state->pending.op = FLAGOP_NONE;
+    state->int_enable = data[8];
+    state->halted = data[9];
+    state->sp = data[10] | data[11] << 8;
+    state->pc = data[12] | data[13] << 8;
+}
+
+bool SeekRewind(RewindBuffer* rewind, State8080* state, const uint64_t target) {
+    std::deque<RewindFrame>& frames = rewind->frames;
+    if (frames.empty() || frames.front().cycles > target)
+        return false;
+
+    size_t last = frames.size() - 1;
+    while (frames[last].cycles > target)
+        last--;
+    size_t key = last;
+    while (!frames[key].keyframe)
+        key--;
+
+    uint64_t cycles = 0;
+    std::vector<uint8_t> devices;
+    const RewindFrame& keyframe = frames[key];
+    if (LoadState(state, &rewind->ring[keyframe.offset], keyframe.size, nullptr, &cycles, &devices) != SAVE_OK)
+        return false;
+    for (size_t frame = key + 1; frame <= last; frame++)
+        ApplyDelta(state, &rewind->ring[frames[frame].offset]);
+
+    //Whatever came after the frame is a future the machine no longer has.
+    const RewindFrame& from = frames[last];
+    rewind->head = from.offset + from.size;
+    rewind->cycles = from.cycles;
+    rewind->next_keyframe = keyframe.cycles + rewind->keyframe_cycles;
+    rewind->next_frame = from.cycles + rewind->frame_cycles;
+    frames.erase(frames.begin() + last + 1, frames.end());
+    ShadowMemory(rewind, state);
+    TakeDirtyPages(rewind, state);
+
+    if (target > rewind->cycles)
+        RunRewound(rewind, state, target - rewind->cycles);
+    else
+        GiveBackDirtyPages(rewind, state);
+    return true;
+}
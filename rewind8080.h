@@ -0,0 +1,66 @@
+#ifndef REWIND8080_H
+#define REWIND8080_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "cpu8080.h"
+
+//Smallest ring a buffer can have: room for a few keyframes of a machine with all of its 64K in use.
+constexpr size_t REWIND_MIN_CAPACITY = 0x40000;
+
+//Where one frame sits in the ring.
+typedef struct RewindFrame {
+    size_t      offset;
+    size_t      size;
+    uint64_t    cycles;     //of the machine when the frame was taken
+    bool        keyframe;
+} RewindFrame;
+
+//A history of one machine, so that it can be sent back to an earlier cycle. A keyframe, a SaveState of
+//the whole machine, is taken every keyframe_cycles and a delta every frame_cycles in between. A delta
+//holds the registers and, for each page stored to since the frame before, the XOR of its old and new
+//bytes with the runs of zeroes squeezed out, so a frame costs about as much as the memory the machine
+//changed. Frames go into a ring of fixed size; when it is full the oldest keyframe and its deltas
+//make room.
+typedef struct RewindBuffer {
+    std::vector<uint8_t>    ring;
+    size_t      head;               //where the next frame goes
+    std::deque<RewindFrame> frames; //oldest first, and always starting with a keyframe
+    uint64_t    keyframe_cycles;
+    uint64_t    frame_cycles;
+    uint64_t    cycles;             //the machine's clock, counted over RunRewound
+    uint64_t    next_keyframe;
+    uint64_t    next_frame;
+    std::array<uint8_t, 0x10000>    shadow;     //memory as of the last frame
+    std::array<uint8_t, 256>        taken;      //pages frames cleared from state->dirty, given back on return
+    std::vector<uint8_t>    scratch;            //the frame being encoded
+    uint64_t    keyframes;          //taken so far, dropped ones included
+    uint64_t    deltas;
+    uint64_t    wraps;              //times the head went back to the start of the ring
+} RewindBuffer;
+
+//A buffer of capacity bytes, at least REWIND_MIN_CAPACITY. Returns nullptr when it is smaller or when
+//memory runs out.
+RewindBuffer* CreateRewindBuffer(size_t capacity, uint64_t keyframe_cycles, uint64_t frame_cycles);
+void DestroyRewindBuffer(RewindBuffer* rewind);
+
+//Run8080 on state, which must have flat memory or a bus whose host pages hold all its RAM, taking
+//frames as it goes. The first run takes a keyframe before it starts. Deltas only look at the pages in
+//state->dirty, and each frame clears the pages it took so that the next one looks only at pages stored
+//to since; they are set again on return. The caller must not clear the dirty map or put pages back
+//with RestoreDirtyPages while the buffer records the machine.
+RunResult RunRewound(RewindBuffer* rewind, State8080* state, uint64_t cycle_budget);
+
+//Sends state back to cycle target: loads the last keyframe at or before it, applies the deltas up to
+//the last frame at or before it and runs from there to target, overshooting by at most an instruction
+//as Run8080 does. Frames after the one it starts from are dropped and the run to target is recorded
+//again. The run uses the port handlers as they are now, so with input that differs from the first
+//time around only the frames themselves are exact. Returns false, leaving state alone, when target is
+//older than the oldest frame kept.
+bool SeekRewind(RewindBuffer* rewind, State8080* state, uint64_t target);
+
+#endif //REWIND8080_H
@@ -0,0 +1,165 @@
+#include <cstring>
+
+#include "savestate8080.h"
+#include "ops8080.h"
+#include "snapshot8080.h"
+
+constexpr size_t HEADER_SIZE = 38;
+//Equal bytes a run carries on over rather than end and start another, which would cost 3 bytes.
+constexpr int RUN_GAP = 3;
+
+static const uint8_t zero_page[DIRTY_PAGE_SIZE] = {};
+
+static void Put16(std::vector<uint8_t>* out, const uint16_t value) {
+    out->push_back(value & 0xff);
+    out->push_back(value >> 8);
+}
+
+static void Put32(std::vector<uint8_t>* out, const uint32_t value) {
+    Put16(out, value & 0xffff);
+    Put16(out, value >> 16);
+}
+
+static void Put64(std::vector<uint8_t>* out, const uint64_t value) {
+    Put32(out, value & 0xffffffff);
+    Put32(out, value >> 32);
+}
+
+static uint16_t Get16(const uint8_t* data) {
+    return data[0] | data[1] << 8;
+}
+
+static uint32_t Get32(const uint8_t* data) {
+    return Get16(data) | static_cast<uint32_t>(Get16(data + 2)) << 16;
+}
+
+static uint64_t Get64(const uint8_t* data) {
+    return Get32(data) | static_cast<uint64_t>(Get32(data + 4)) << 32;
+}
+
+//Four independent multiply chains, so the multiplies overlap instead of each waiting on the last.
+uint32_t BaselineHash(const uint8_t* baseline) {
+    uint64_t hash[4] = {1, 2, 3, 4};
+    for (int offset = 0; offset < 0x10000; offset += sizeof(hash)) {
+        uint64_t words[4];
+        std::memcpy(words, baseline + offset, sizeof(words));
+        for (int lane = 0; lane < 4; lane++)
+            hash[lane] = (hash[lane] ^ words[lane]) * 0xff51afd7ed558ccdULL;
+    }
+    const uint64_t all = hash[0] ^ hash[1] << 1 ^ hash[2] << 2 ^ hash[3] << 3;
+    return static_cast<uint32_t>(all ^ all >> 32);
+}
+
+void SaveState(const State8080* state, const uint64_t cycles, const uint8_t* baseline,
+               const std::vector<uint8_t>& devices, std::vector<uint8_t>* out) {
+    State8080 settled = *state;
+    DefaultFlags::Settle(&settled);
+
+    out->insert(out->end(), {'8', '0', '8', '0'});
+    Put16(out, SAVESTATE_VERSION);
+    Put16(out, HEADER_SIZE);
+    Put32(out, baseline != nullptr ? SAVESTATE_DELTA : 0);
+    Put32(out, baseline != nullptr ? BaselineHash(baseline) : 0);
+    Put64(out, cycles);
+    out->insert(out->end(), {settled.a, settled.b, settled.c, settled.d, settled.e, settled.h, settled.l,
+                             settled.cc.psw, settled.int_enable, settled.halted});
+    Put16(out, settled.sp);
+    Put16(out, settled.pc);
+
+    const size_t count_at = out->size();
+    uint32_t runs = 0;
+    Put32(out, 0);
+    for (int page = 0; page < 256; page++) {
+        const uint8_t* host = HostPage(state, page);
+        const uint8_t* base = baseline != nullptr ? baseline + page * DIRTY_PAGE_SIZE : zero_page;
+        if (host == nullptr || std::memcmp(host, base, DIRTY_PAGE_SIZE) == 0)
+            continue;
+
+        for (int start = 0; start < DIRTY_PAGE_SIZE;) {
+            if (host[start] == base[start]) {
+                start++;
+                continue;
+            }
+            //Extends the run to the last differing byte that is no more than RUN_GAP past the one before.
+            int end = start + 1;
+            for (int next = end; next < DIRTY_PAGE_SIZE && next <= end + RUN_GAP; next++) {
+                if (host[next] != base[next])
+                    end = next + 1;
+            }
+            Put16(out, static_cast<uint16_t>(page * DIRTY_PAGE_SIZE + start));
+            out->push_back(static_cast<uint8_t>(end - start - 1));
+            out->insert(out->end(), host + start, host + end);
+            runs++;
+            start = end;
+        }
+    }
+    for (int i = 0; i < 4; i++)
+        (*out)[count_at + i] = static_cast<uint8_t>(runs >> (i * 8));
+
+    Put32(out, static_cast<uint32_t>(devices.size()));
+    out->insert(out->end(), devices.begin(), devices.end());
+}
+
+SaveStatus LoadState(State8080* state, const uint8_t* data, const size_t size, const uint8_t* baseline,
+                     uint64_t* cycles, std::vector<uint8_t>* devices) {
+    if (size < 8 || std::memcmp(data, "8080", 4) != 0)
+        return size < 4 ? SAVE_CORRUPT : SAVE_NOT_A_STATE;
+    if (Get16(data + 4) != SAVESTATE_VERSION)
+        return SAVE_WRONG_VERSION;
+    const size_t header = Get16(data + 6);
+    if (header < HEADER_SIZE || size < header + 4)
+        return SAVE_CORRUPT;
+    const bool delta = Get32(data + 8) & SAVESTATE_DELTA;
+    if (delta != (baseline != nullptr) || (delta && Get32(data + 12) != BaselineHash(baseline)))
+        return SAVE_WRONG_BASELINE;
+
+    //Checks every run before anything is stored, so a bad state leaves the machine alone.
+    const size_t memory = header + 4;
+    const uint32_t runs = Get32(data + header);
+    size_t at = memory;
+    uint32_t next = 0;
+    for (uint32_t run = 0; run < runs; run++) {
+        if (size < at + 3)
+            return SAVE_CORRUPT;
+        const uint16_t address = Get16(data + at);
+        const int length = data[at + 2] + 1;
+        if (address < next || (address % DIRTY_PAGE_SIZE) + length > DIRTY_PAGE_SIZE || size < at + 3 + length)
+            return SAVE_CORRUPT;
+        next = address + length;
+        at += 3 + length;
+    }
+    if (size < at + 4 || size - at - 4 < Get32(data + at))
+        return SAVE_CORRUPT;
+    devices->assign(data + at + 4, data + at + 4 + Get32(data + at));
+
+    *cycles = Get64(data + 16);
+    state->a = data[24];
+    state->b = data[25];
+    state->c = data[26];
+    state->d = data[27];
+    state->e = data[28];
+    state->h = data[29];
+    state->l = data[30];
+    state->cc.psw = (data[31] & PSW_FLAGS) | PSW_FIXED;
+    state->pending.op = FLAGOP_NONE;
+    state->int_enable = data[32];
+    state->halted = data[33];
+    state->sp = Get16(data + 34);
+    state->pc = Get16(data + 36);
+
+    //Builds each page as saved, then stores only the bytes where the machine holds something else.
+    at = memory;
+    uint32_t run = 0;
+    for (int page = 0; page < 256; page++) {
+        uint8_t saved[DIRTY_PAGE_SIZE];
+        std::memcpy(saved, baseline != nullptr ? baseline + page * DIRTY_PAGE_SIZE : zero_page, DIRTY_PAGE_SIZE);
+        for (; run < runs && Get16(data + at) / DIRTY_PAGE_SIZE == page; run++) {
+            const int length = data[at + 2] + 1;
+            std::memcpy(saved + Get16(data + at) % DIRTY_PAGE_SIZE, data + at + 3, length);
+            at += 3 + length;
+        }
+        StorePage(state, page, saved);
+    }
+
+    return SAVE_OK;
+}
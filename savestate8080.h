@@ -0,0 +1,58 @@
+#ifndef SAVESTATE8080_H
+#define SAVESTATE8080_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cpu8080.h"
+
+//A machine saved as bytes, so that a long run can be checkpointed and resumed, possibly in another
+//process. Every field is little-endian.
+//
+//  offset  size    field
+//  0       4       magic "8080"
+//  4       2       version, SAVESTATE_VERSION; readers refuse any other
+//  6       2       header size, the offset of the memory section. Fields added within a version go at
+//                  the end of the header, and readers skip the ones they do not know.
+//  8       4       flags, SAVESTATE_DELTA when memory is stored against a baseline
+//  12      4       BaselineHash of that baseline, 0 without one
+//  16      8       cycles the machine has run, as counted by whoever saved it
+//  24      1 each  a, b, c, d, e, h, l, psw (settled), int_enable, halted
+//  34      2 each  sp, pc
+//  38              end of the version 1 header
+//
+//The memory section follows: a 4-byte count of runs, then each run as a 2-byte address, a 1-byte
+//length minus one and its bytes. Runs never cross a 256-byte page and come in address order. Bytes
+//no run covers are those of the baseline, or 0 without one, so a machine that has only touched a
+//few pages of its ROM saves as a few hundred bytes. The device section comes last: a 4-byte length and
+//that many bytes, which the emulator never looks into. Port handlers and devices belong to the caller,
+//which puts whatever state it needs there.
+constexpr uint16_t SAVESTATE_VERSION = 1;
+constexpr uint32_t SAVESTATE_DELTA = 1;
+
+enum SaveStatus : uint8_t {
+    SAVE_OK,
+    SAVE_NOT_A_STATE,       //the magic is wrong
+    SAVE_WRONG_VERSION,
+    SAVE_CORRUPT,           //truncated, or a section runs past its end or out of order
+    SAVE_WRONG_BASELINE,    //saved against a different baseline than the one given, or with none
+};
+
+//Identifies a 64K baseline, so that a state is only ever loaded against the memory it was saved against.
+uint32_t BaselineHash(const uint8_t* baseline);
+
+//Appends the save state of state to out. baseline is the 64K the memory is stored against, usually
+//the image as loaded, or nullptr to store it against zeroes. Memory is read from flat memory or from
+//the host pages of the bus; pages a handler serves are left out.
+void SaveState(const State8080* state, uint64_t cycles, const uint8_t* baseline, const std::vector<uint8_t>& devices,
+               std::vector<uint8_t>* out);
+
+//Puts the machine saved in data back into state, keeping its memory pointer or bus, port handlers and
+//caches. Only bytes that differ from what state holds are stored, each dirtying its page and
+//invalidating any code cached over it, as RestoreDirtyPages does; the rest of the load is one pass
+//comparing 64K. Sets cycles and devices from the state. On any error state is left as it was.
+SaveStatus LoadState(State8080* state, const uint8_t* data, size_t size, const uint8_t* baseline, uint64_t* cycles,
+                     std::vector<uint8_t>* devices);
+
+#endif //SAVESTATE8080_H
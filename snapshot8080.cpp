@@ -0,0 +1,66 @@
+#include <cstring>
+
+#include "snapshot8080.h"
+#include "ops8080.h"
+
+uint8_t* HostPage(const State8080* state, const int page) {
+    return state->memory != nullptr ? state->memory + page * DIRTY_PAGE_SIZE : state->bus->host_write[page];
+}
+
+bool StorePage(State8080* state, const int page, const uint8_t* bytes) {
+    uint8_t* host = HostPage(state, page);
+    if (host == nullptr || std::memcmp(host, bytes, DIRTY_PAGE_SIZE) == 0)
+        return false;
+
+    //Only bytes that really change can make cached code stale.
+    const bool mirrored = state->memory == nullptr && state->bus->mirror[page] != page;
+    for (int i = 0; i < DIRTY_PAGE_SIZE; i++) {
+        if (host[i] == bytes[i])
+            continue;
+        const uint16_t address = static_cast<uint16_t>(page * DIRTY_PAGE_SIZE + i);
+        host[i] = bytes[i];
+        InvalidateStore(state, address);
+        if (mirrored)
+            InvalidateMirrors(state, address);
+    }
+    state->dirty[page] = 1;
+    return true;
+}
+
+void ClearDirtyPages(State8080* state) {
+    state->dirty.fill(0);
+}
+
+std::vector<uint8_t> DirtyPages(const State8080* state) {
+    std::vector<uint8_t> pages;
+    for (int page = 0; page < 256; page++) {
+        if (state->dirty[page])
+            pages.push_back(static_cast<uint8_t>(page));
+    }
+    return pages;
+}
+
+size_t RestoreDirtyPages(State8080* state, const uint8_t* baseline) {
+    size_t restored = 0;
+    for (int page = 0; page < 256; page++) {
+        if (!state->dirty[page])
+            continue;
+        if (StorePage(state, page, baseline + page * DIRTY_PAGE_SIZE))
+            restored++;
+        state->dirty[page] = 0;
+    }
+    return restored;
+}
+
+State8080 ForkState(const State8080* parent, uint8_t* memory) {
+    State8080 fork = *parent;
+    DefaultFlags::Settle(&fork);
+    fork.memory = memory;
+    fork.bus = nullptr;
+    fork.predecode = nullptr;
+    fork.blocks = nullptr;
+    fork.jit = nullptr;
+    fork.aot = nullptr;
+    fork.dirty.fill(0);
+    return fork;
+}
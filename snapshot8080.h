@@ -0,0 +1,41 @@
+#ifndef SNAPSHOT8080_H
+#define SNAPSHOT8080_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cpu8080.h"
+
+constexpr int DIRTY_PAGE_SIZE = 0x100;
+
+//Every store that reaches memory marks its 256-byte page in State8080::dirty, whichever engine runs
+//it, so a caller can save or restore only the pages a run changed. Stores handed to a device page
+//handler are not tracked.
+
+//The host memory behind a page, or nullptr for a page a handler serves or ROM that stores cannot reach.
+uint8_t* HostPage(const State8080* state, int page);
+
+//Makes page hold bytes, storing only the bytes that differ. Each store invalidates code cached over
+//the byte at its address and at its mirrors, as Write8 would, and marks the page dirty. Returns
+//whether any byte changed; a page HostPage cannot reach is left alone.
+bool StorePage(State8080* state, int page, const uint8_t* bytes);
+
+//Forgets every page stored to so far, e.g. right after taking a baseline copy of memory.
+void ClearDirtyPages(State8080* state);
+
+//The pages stored to since ClearDirtyPages, in address order. Page p covers p * 256 to p * 256 + 255.
+std::vector<uint8_t> DirtyPages(const State8080* state);
+
+//Puts the dirty pages of memory back to what baseline, a 64K copy taken when the map was cleared,
+//holds for them, and clears the map. Code cached over a restored byte is invalidated as if the byte
+//had been stored. Resetting this way copies only what the run changed instead of all 64K. Returns the
+//number of pages restored.
+size_t RestoreDirtyPages(State8080* state, const uint8_t* baseline);
+
+//A machine that carries on from parent with memory as its own flat 64K, e.g. a CloneArena of an image
+//of parent's memory. Registers, flags, interrupt state and port handlers are copied; the caches
+//belong to parent, so the fork starts without any, and its dirty map starts empty.
+State8080 ForkState(const State8080* parent, uint8_t* memory);
+
+#endif //SNAPSHOT8080_H
@@ -0,0 +1,44 @@
+#Runs the jobs in MANIFEST against IMAGE with -t on one thread and on THREADS, and fails unless both
+#print the same line for every job, and the jobs named in SAME, which run the same input after others,
+#print the same line apart from their names. Line LINE of MALFORMED must be refused before any job runs.
+#cmake -DEMULATOR=... -DIMAGE=... -DMANIFEST=... -DTHREADS=... -DSAME=a,b -DMALFORMED=... -DLINE=... -P batch.cmake
+foreach (threads 1 ${THREADS})
+    execute_process(COMMAND ${EMULATOR} -T ${threads} -t ${MANIFEST} ${IMAGE}
+                    OUTPUT_VARIABLE output
+                    RESULT_VARIABLE status)
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "-T ${threads} -t exited with ${status}")
+    endif ()
+    set(output${threads} "${output}")
+endforeach ()
+if (NOT output${THREADS} STREQUAL output1)
+    message(FATAL_ERROR "the jobs end differently on ${THREADS} threads\n1:\n${output1}\n${THREADS}:\n"
+                        "${output${THREADS}}")
+endif ()
+
+file(STRINGS ${MANIFEST} jobs REGEX "^[^#]")
+string(REGEX MATCHALL "[^\n]+" lines "${output1}")
+list(LENGTH jobs expected)
+list(LENGTH lines printed)
+if (NOT printed EQUAL expected)
+    message(FATAL_ERROR "${printed} lines for ${expected} jobs\n${output1}")
+endif ()
+
+string(REPLACE "," ";" names "${SAME}")
+foreach (name ${names})
+    string(REGEX MATCH "(^|\n)${name} ([^\n]*)" line "${output1}")
+    list(APPEND same "${CMAKE_MATCH_2}")
+endforeach ()
+list(REMOVE_DUPLICATES same)
+list(LENGTH same distinct)
+if (NOT distinct EQUAL 1)
+    message(FATAL_ERROR "${SAME} ran the same input but ended differently\n${output1}")
+endif ()
+
+execute_process(COMMAND ${EMULATOR} -t ${MALFORMED} ${IMAGE}
+                OUTPUT_VARIABLE output
+                ERROR_VARIABLE error
+                RESULT_VARIABLE status)
+if (status EQUAL 0 OR NOT output STREQUAL "" OR NOT error MATCHES "line ${LINE} is not")
+    message(FATAL_ERROR "line ${LINE} of ${MALFORMED} was not refused\nexit ${status}\n${output}${error}")
+endif ()
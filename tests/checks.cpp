@@ -0,0 +1,255 @@
+//Checks of the library the command line cannot reach, each run as its own test: 8080_checks name exits
+//with 0 when the check called name passes, and otherwise says what went wrong.
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu8080.h"
+#include "arena8080.h"
+#include "blocks8080.h"
+#include "bus8080.h"
+#include "jit8080.h"
+#include "snapshot8080.h"
+
+static bool Fail(const char* what) {
+    std::cerr << what << std::endl;
+    return false;
+}
+
+//A second Watchpoints is refused while one is attached, and only the first one sees hits.
+static bool WatchRefusesSecondSet() {
+    //STA 2180; STA 2200; HLT
+    const std::vector<uint8_t> program = {0x32, 0x80, 0x21, 0x32, 0x00, 0x22, 0x76};
+    std::vector<uint8_t> ram(0x10000);
+    std::copy(program.begin(), program.end(), ram.begin());
+    std::unique_ptr<MemoryBus> bus(new MemoryBus());
+    std::unique_ptr<Watchpoints> first(new Watchpoints()), second(new Watchpoints());
+    MapRam(bus.get(), 0x0000, 0x10000, ram.data());
+    if (!Watch(bus.get(), first.get(), 0x2180, WATCH_WRITE))
+        return Fail("the first Watchpoints was refused");
+    if (Watch(bus.get(), second.get(), 0x2200, WATCH_WRITE))
+        return Fail("a second Watchpoints was attached");
+    if (bus->watch != first.get() || first->kinds[0x2200] != 0 || second->kinds[0x2200] != 0)
+        return Fail("refusing a second Watchpoints changed a set");
+
+    State8080 state = {};
+    state.bus = bus.get();
+    Run8080(&state, 1000);
+    if (first->hits.size() != 1 || first->hits[0].address != 0x2180 || !second->hits.empty())
+        return Fail("the stores hit the wrong watchpoints");
+    return true;
+}
+
+//The Space Invaders layout -m sets up: 8K of ROM from memory, then its next 8K as RAM mirrored up to
+//the top of the address space.
+static void MapInvaders(MemoryBus* bus, uint8_t* memory) {
+    MapRom(bus, 0x0000, 0x2000, memory);
+    for (uint32_t address = 0x2000; address < 0x10000; address += 0x2000)
+        MapRam(bus, address, 0x2000, memory + 0x2000);
+}
+
+//Runs program, loaded at 0 of a fresh Space Invaders map, on the interpreter, the block engine and,
+//when this build has it, the JIT, handing each finished machine to check.
+static bool RunOnEngines(const std::vector<uint8_t>& program, bool (*check)(const State8080* state)) {
+    for (int engine = 0; engine < 3; engine++) {
+        std::vector<uint8_t> memory(0x4000);
+        std::copy(program.begin(), program.end(), memory.begin());
+        std::unique_ptr<MemoryBus> bus(new MemoryBus());
+        std::unique_ptr<BlockCache> blocks(engine == 1 ? new BlockCache() : nullptr);
+        std::unique_ptr<JitCache, void (*)(JitCache*)> jit(engine == 2 ? CreateJitCache() : nullptr,
+                                                           DestroyJitCache);
+        if (engine == 2 && !jit)
+            continue;
+        MapInvaders(bus.get(), memory.data());
+        State8080 state = {};
+        state.bus = bus.get();
+        state.blocks = jit ? &jit->blocks : blocks.get();
+        state.jit = jit.get();
+        Run8080(&state, 100000);
+        if (!check(&state))
+            return false;
+    }
+    return true;
+}
+
+//A store through one mirror of RAM reads back through the others, and drops code cached at the page it
+//mirrors: the loop patches its own MVI A through 4001, so its second pass must load the new value.
+static bool MirrorsShareMemory() {
+    const std::vector<uint8_t> program = {
+        0x3e, 0x5a, 0x32, 0x00, 0x21,   //MVI A,5a; STA 2100
+        0x3a, 0x00, 0x61, 0x47,         //LDA 6100; MOV B,A
+        0x21, 0x00, 0xe1, 0x5e,         //LXI H,e100; MOV E,M
+        0x21, 0x00, 0x20,               //LXI H,2000
+        0x36, 0x3e, 0x23, 0x36, 0x11,   //MVI M,3e; INX H; MVI M,11, so 2000 holds MVI A,11
+        0x21, 0x02, 0x20,               //LXI H,2002
+        0x36, 0x82, 0x23, 0x36, 0x57,   //ADD D; MOV D,A
+        0x23, 0x36, 0x3e, 0x23, 0x36, 0x22,                     //MVI A,22
+        0x23, 0x36, 0x32, 0x23, 0x36, 0x01, 0x23, 0x36, 0x40,   //STA 4001
+        0x23, 0x36, 0x0d,                                       //DCR C
+        0x23, 0x36, 0xc2, 0x23, 0x36, 0x00, 0x23, 0x36, 0x20,   //JNZ 2000
+        0x23, 0x36, 0x76,                                       //HLT
+        0x16, 0x00, 0x0e, 0x02,         //MVI D,0; MVI C,2
+        0xc3, 0x00, 0x20,               //JMP 2000
+    };
+    return RunOnEngines(program, [](const State8080* state) {
+        if (state->b != 0x5a || state->e != 0x5a)
+            return Fail("a store through 2100 did not read back through 6100 and e100");
+        if (state->d != 0x33)
+            return Fail("code patched through a mirror ran stale");
+        return true;
+    });
+}
+
+//A copy and a fill the block engine runs as one memmove or memset still report each access to a
+//watched address inside them, and carry on past it.
+static bool BulkLoopsReportWatchedAccesses() {
+    const std::vector<uint8_t> program = {
+        0x21, 0x00, 0x10, 0x11, 0x80, 0x22, 0x06, 0x20,    //LXI H,1000; LXI D,2280; MVI B,20
+        0x7e, 0x12, 0x23, 0x13, 0x05, 0xc2, 0x08, 0x00,    //MOV A,M; STAX D; INX H; INX D; DCR B; JNZ
+        0x21, 0x00, 0x23, 0x06, 0x20,                      //LXI H,2300; MVI B,20
+        0x36, 0xaa, 0x23, 0x05, 0xc2, 0x15, 0x00,          //MVI M,aa; INX H; DCR B; JNZ
+        0x76,                                              //HLT
+    };
+    for (int engine = 0; engine < 2; engine++) {
+        std::vector<uint8_t> memory(0x4000);
+        std::copy(program.begin(), program.end(), memory.begin());
+        for (int i = 0; i < 0x20; i++)
+            memory[0x1000 + i] = static_cast<uint8_t>(i * 7 + 1);
+        std::unique_ptr<MemoryBus> bus(new MemoryBus());
+        std::unique_ptr<Watchpoints> watch(new Watchpoints());
+        std::unique_ptr<BlockCache> blocks(engine == 1 ? new BlockCache() : nullptr);
+        MapInvaders(bus.get(), memory.data());
+        Watch(bus.get(), watch.get(), 0x1010, WATCH_READ);
+        Watch(bus.get(), watch.get(), 0x2290, WATCH_WRITE);
+        Watch(bus.get(), watch.get(), 0x2310, WATCH_WRITE);
+        State8080 state = {};
+        state.bus = bus.get();
+        state.blocks = blocks.get();
+        Run8080(&state, 100000);
+
+        if (!state.halted || memory[0x229f] != 0x1f * 7 + 1 || memory[0x231f] != 0xaa)
+            return Fail("the copy or the fill did not finish");
+        //The pc of a hit depends on the engine, so only the address, value and kind are compared.
+        const WatchHit expected[] = {{0x1010, 0, 0x71, WATCH_READ}, {0x2290, 0, 0x71, WATCH_WRITE},
+                                     {0x2310, 0, 0xaa, WATCH_WRITE}};
+        const std::vector<WatchHit>& hits = watch->hits;
+        bool same = hits.size() == 3;
+        for (size_t i = 0; same && i < hits.size(); i++) {
+            same = hits[i].address == expected[i].address && hits[i].value == expected[i].value &&
+                   hits[i].kind == expected[i].kind;
+        }
+        if (!same && engine == 0)
+            return Fail("the interpreter missed a watched access");
+        if (!same)
+            return Fail("a bulk loop missed a watched access");
+    }
+    return true;
+}
+
+//Calls a subroutine, patches its MVI A and calls it again, so the run ends with the patched code
+//cached; then fills a page and pushes the result. Ends with d 33.
+static const std::vector<uint8_t> SELF_PATCHING = {
+    0x31, 0x00, 0xf0, 0xcd, 0x20, 0x00, //LXI SP,f000; CALL 0020
+    0x3e, 0x22, 0x32, 0x21, 0x00,       //MVI A,22; STA 0021
+    0xcd, 0x20, 0x00,                   //CALL 0020
+    0x21, 0x00, 0x80, 0x06, 0x00,       //LXI H,8000; MVI B,0
+    0x36, 0xaa, 0x23, 0x05, 0xc2, 0x13, 0x00,   //MVI M,aa; INX H; DCR B; JNZ
+    0xd5, 0x76, 0x00, 0x00, 0x00, 0x00, //PUSH D; HLT
+    0x3e, 0x11, 0x82, 0x57, 0xc9,       //0020: MVI A,11; ADD D; MOV D,A; RET
+};
+
+//RestoreDirtyPages after a run puts back exactly the pages it dirtied, so memory is the baseline again,
+//and drops the code cached over them: a second run on the same caches ends as the first did.
+static bool RestoreBringsBackBaseline() {
+    for (int engine = 0; engine < 3; engine++) {
+        std::vector<uint8_t> memory(0x10000), baseline(0x10000);
+        std::copy(SELF_PATCHING.begin(), SELF_PATCHING.end(), memory.begin());
+        baseline = memory;
+        std::unique_ptr<BlockCache> blocks(engine == 1 ? new BlockCache() : nullptr);
+        std::unique_ptr<JitCache, void (*)(JitCache*)> jit(engine == 2 ? CreateJitCache() : nullptr,
+                                                           DestroyJitCache);
+        if (engine == 2 && !jit)
+            continue;
+        for (int run = 0; run < 2; run++) {
+            State8080 state = {};
+            state.memory = memory.data();
+            state.blocks = jit ? &jit->blocks : blocks.get();
+            state.jit = jit.get();
+            Run8080(&state, 100000);
+            if (!state.halted || state.d != 0x33)
+                return Fail(run == 0 ? "the program ended in the wrong state" : "a restored byte ran stale code");
+            if (DirtyPages(&state) != std::vector<uint8_t>{0x00, 0x80, 0xef})
+                return Fail("the run dirtied other pages than 00, 80 and ef");
+            if (RestoreDirtyPages(&state, baseline.data()) != 3 || !DirtyPages(&state).empty())
+                return Fail("RestoreDirtyPages did not restore and clear the three pages");
+            if (memory != baseline)
+                return Fail("memory differs from the baseline after RestoreDirtyPages");
+        }
+    }
+    return true;
+}
+
+//Machines forked from a running parent onto copy-on-write clones of its memory carry on from where it
+//was, each with memory of its own: a fork ends as its parent does, a fork given another D pushes it
+//without the others seeing it, and neither stores into the image they share.
+static bool ForksAreIndependent() {
+    std::unique_ptr<MemoryArena, void (*)(MemoryArena*)> arena(CreateArena(ARENA_GUARDED), DestroyArena);
+    if (!arena)
+        return Fail("no memory for the parent");
+    std::copy(SELF_PATCHING.begin(), SELF_PATCHING.end(), arena->memory);
+    State8080 parent = {};
+    parent.memory = arena->memory;
+    Run8080(&parent, 200);      //both calls are done and the fill has started
+
+    std::unique_ptr<ArenaImage, void (*)(ArenaImage*)> image(CreateArenaImage(parent.memory), DestroyArenaImage);
+    const std::vector<uint8_t> booted(parent.memory, parent.memory + 0x10000);
+    std::unique_ptr<MemoryArena, void (*)(MemoryArena*)> first(image ? CloneArena(image.get()) : nullptr,
+                                                               DestroyArena);
+    std::unique_ptr<MemoryArena, void (*)(MemoryArena*)> second(image ? CloneArena(image.get()) : nullptr,
+                                                                DestroyArena);
+    std::unique_ptr<BlockCache> blocks(new BlockCache());
+    if (!first || !second)
+        return Fail("no memory for the forks");
+
+    State8080 changed = ForkState(&parent, second->memory);
+    changed.blocks = blocks.get();
+    changed.d = 0x10;
+    Run8080(&changed, 100000);
+    State8080 fork = ForkState(&parent, first->memory);
+    Run8080(&fork, 100000);
+    Run8080(&parent, 100000);
+
+    if (!fork.halted || fork.d != parent.d || !std::equal(parent.memory, parent.memory + 0x10000, fork.memory))
+        return Fail("a fork ended elsewhere than its parent");
+    if (DirtyPages(&fork) != std::vector<uint8_t>{0x80, 0xef})
+        return Fail("a fork's dirty map holds pages stored to before it was forked");
+    if (!changed.halted || changed.memory[0xefff] != 0x10 || fork.memory[0xefff] != 0x33)
+        return Fail("a store in one fork reached another");
+    if (!std::equal(booted.begin(), booted.end(), image->memory))
+        return Fail("a fork stored into the image it was cloned from");
+    return true;
+}
+
+typedef struct Check {
+    const char  *name;
+    bool        (*run)();
+} Check;
+
+static const Check CHECKS[] = {
+    {"watch_refuses_second", WatchRefusesSecondSet},
+    {"mirrors", MirrorsShareMemory},
+    {"bulk_watch", BulkLoopsReportWatchedAccesses},
+    {"restore", RestoreBringsBackBaseline},
+    {"fork", ForksAreIndependent},
+};
+
+int main(int argc, char* argv[]) {
+    for (const Check& check : CHECKS) {
+        if (argc == 2 && argv[1] == std::string(check.name))
+            return check.run() ? 0 : 1;
+    }
+    std::cerr << "Usage: " << argv[0] << " check" << std::endl;
+    return 1;
+}
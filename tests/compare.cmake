@@ -0,0 +1,21 @@
+#Runs EMULATOR on IMAGE for CYCLES with -r and with MODE, and fails unless both print the same first
+#line: the cycles, instructions and registers the run ended with. With ADDRESS set the image is loaded
+#there, and with EXPECT set the line must also match that regular expression.
+#cmake -DEMULATOR=... -DMODE=-b -DCYCLES=... -DIMAGE=... [-DADDRESS=100] [-DEXPECT=...] -P compare.cmake
+foreach (run -r ${MODE})
+    execute_process(COMMAND ${EMULATOR} ${run} ${CYCLES} ${IMAGE} ${ADDRESS}
+                    OUTPUT_VARIABLE output
+                    RESULT_VARIABLE status)
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "${run} exited with ${status}")
+    endif ()
+    string(REGEX MATCH "^[^\n]*" line "${output}")
+    set(line${run} "${line}")
+endforeach ()
+
+if (NOT line${MODE} STREQUAL line-r)
+    message(FATAL_ERROR "${MODE} and -r end in different states\n-r       ${line-r}\n${MODE}       ${line${MODE}}")
+endif ()
+if (DEFINED EXPECT AND NOT line-r MATCHES "${EXPECT}")
+    message(FATAL_ERROR "-r does not end in the expected state\nexpected ${EXPECT}\n-r       ${line-r}")
+endif ()
@@ -0,0 +1,20 @@
+#Runs EMULATOR on IMAGE with MODE, which lists the most executed blocks, and fails if any block ran more
+#than MAX times: each loop in IMAGE should be fast-forwarded in a single dispatch, not interpreted.
+#cmake -DEMULATOR=... -DMODE=-b -DCYCLES=... -DIMAGE=... -DMAX=2 -P fastforward.cmake
+execute_process(COMMAND ${EMULATOR} ${MODE} ${CYCLES} ${IMAGE}
+                OUTPUT_VARIABLE output
+                RESULT_VARIABLE status)
+if (NOT status EQUAL 0)
+    message(FATAL_ERROR "${MODE} exited with ${status}")
+endif ()
+
+string(REGEX MATCHALL "[0-9a-f]+-[0-9a-f]+ ops [0-9]+ executions [0-9]+" blocks "${output}")
+if (NOT blocks)
+    message(FATAL_ERROR "${MODE} listed no blocks\n${output}")
+endif ()
+foreach (block ${blocks})
+    string(REGEX REPLACE ".* executions " "" executions "${block}")
+    if (executions GREATER MAX)
+        message(FATAL_ERROR "a loop was interpreted instead of fast-forwarded: ${block}")
+    endif ()
+endforeach ()
@@ -0,0 +1,30 @@
+#Fuzzes IMAGE with -f for CYCLES a run on one thread, so the session is repeatable, and fails unless the
+#corpus grows to MIN inputs or more. The corpus is written to MANIFEST and replayed with -t, which must
+#run every input in it.
+#cmake -DEMULATOR=... -DCYCLES=... -DIMAGE=... -DMIN=... -DMANIFEST=... -P fuzz.cmake
+execute_process(COMMAND ${EMULATOR} -T 1 -f ${CYCLES} ${IMAGE}
+                OUTPUT_VARIABLE corpus
+                RESULT_VARIABLE status)
+if (NOT status EQUAL 0)
+    message(FATAL_ERROR "-f exited with ${status}")
+endif ()
+if (NOT corpus MATCHES "^# runs [0-9]+ edges [0-9]+ corpus ([0-9]+)\n")
+    message(FATAL_ERROR "-f printed no corpus size\n${corpus}")
+endif ()
+set(inputs ${CMAKE_MATCH_1})
+if (inputs LESS MIN)
+    message(FATAL_ERROR "the corpus only grew to ${inputs} inputs, not ${MIN}\n${corpus}")
+endif ()
+
+file(WRITE ${MANIFEST} "${corpus}")
+execute_process(COMMAND ${EMULATOR} -t ${MANIFEST} ${IMAGE}
+                OUTPUT_VARIABLE output
+                RESULT_VARIABLE status)
+if (NOT status EQUAL 0)
+    message(FATAL_ERROR "-t on the corpus exited with ${status}")
+endif ()
+string(REGEX MATCHALL "(^|\n)input[0-9]+ cycles ${CYCLES} " jobs "${output}")
+list(LENGTH jobs replayed)
+if (NOT replayed EQUAL inputs)
+    message(FATAL_ERROR "-t replayed ${replayed} of the ${inputs} inputs\n${output}")
+endif ()
@@ -0,0 +1,329 @@
+#Writes the guest images in tests/images. They are checked in, so this only needs to run when one of them
+#changes: python3 tests/make_images.py tests/images
+import os
+import random
+import sys
+
+
+def w16(v):
+    return [v & 0xff, v >> 8]
+
+
+#Every pair of A and operand through the ALU, DAA after each result, DAA on every A with every flag byte
+#restored through POP PSW, and the rotates. Halts after the last pair.
+def alu():
+    c = [0x31] + w16(0xf000)                    #LXI SP,f000
+    c += [0x01] + w16(0)                        #LXI B,0      B is A, C the operand
+    top = len(c)
+    for op in (0x81, 0x89, 0x91, 0x99):         #ADD/ADC/SUB/SBB C, with the carry the last DAA left
+        c += [0x78, op, 0x27]                   #MOV A,B; op; DAA
+    for op in (0x89, 0x99):                     #ADC/SBB C with the carry set
+        c += [0x78, 0x37, op, 0x27]             #MOV A,B; STC; op; DAA
+    for op in (0xa1, 0xa9, 0xb1, 0xb9):         #ANA/XRA/ORA/CMP C
+        c += [0x78, op]
+    c += [0x78, 0x3c, 0x27, 0x78, 0x3d, 0x27]   #MOV A,B; INR A; DAA; MOV A,B; DCR A; DAA
+    c += [0x61, 0x68, 0xe5, 0xf1, 0x27]         #MOV H,C; MOV L,B; PUSH H; POP PSW; DAA
+    c += [0x61, 0x68, 0xe5, 0xf1, 0x3f, 0x27]   #the same with the carry complemented
+    c += [0x78, 0x07, 0x0f, 0x17, 0x1f, 0x2f]   #MOV A,B; RLC; RRC; RAL; RAR; CMA
+    c += [0x0c, 0xc2] + w16(top)                #INR C; JNZ top
+    c += [0x04, 0xc2] + w16(top)                #INR B; JNZ top
+    c += [0x76]
+    return bytes(c)
+
+
+#3K of random ALU instructions with conditional jumps over a single instruction.
+def branches(seed):
+    rng = random.Random(seed)
+    one = [0x04, 0x05, 0x0c, 0x0d, 0x14, 0x15, 0x1c, 0x1d, 0x24, 0x25, 0x2c, 0x2d, 0x3c, 0x3d, 0x03, 0x0b, 0x13,
+           0x1b, 0x23, 0x2b, 0x2f, 0x37, 0x3f, 0x0f, 0x1f, 0x09, 0x19, 0x29] + list(range(0x80, 0xb8)) + \
+          [x for x in range(0x40, 0x80) if x & 7 not in (6,) and x < 0x70 or 0x78 <= x < 0x80 and x != 0x7e]
+    jcc = [0xc2, 0xca, 0xd2, 0xda, 0xe2, 0xea, 0xf2, 0xfa]
+    out = bytearray()
+    while len(out) < 3000:
+        r = rng.random()
+        if r < 0.6:
+            out.append(rng.choice(one))
+        elif r < 0.85:
+            out += bytes([rng.choice([0xe6, 0xfe]), rng.randrange(256)])
+        else:
+            a = len(out) + 3
+            out += bytes([rng.choice(jcc), a & 0xff, a >> 8, rng.choice(one)])
+    out.append(0x76)
+    return bytes(out)
+
+
+#16K of random bytes other than HLT after setting up the stack, so every opcode and wild jumps get run.
+def opcodes(seed):
+    rng = random.Random(seed)
+    out = bytearray([0x31, 0x00, 0xf0])
+    while len(out) < 0x4000:
+        b = rng.randrange(256)
+        if b != 0x76:
+            out.append(b)
+    return bytes(out)
+
+
+#Short random blocks closed by jumps, mostly backward, with stores into the 16K that holds the code.
+def selfmodifying(seed):
+    rng = random.Random(seed)
+    mem = bytearray(rng.randrange(256) for _ in range(0x4000))
+    for i in range(len(mem)):
+        if mem[i] == 0x76:
+            mem[i] = 0
+    out = bytearray([0x31, 0x00, 0xf0, 0x21, 0x00, 0x10])
+    body = [x for x in range(0x40, 0xc0) if x != 0x76] + \
+           [0x04, 0x0c, 0x14, 0x1c, 0x24, 0x2c, 0x3c, 0x05, 0x0d, 0x15, 0x1d, 0x25, 0x2d, 0x3d, 0x03, 0x13, 0x23, 0x0b,
+            0x1b, 0x2b, 0x09, 0x19, 0x29, 0x39, 0x0a, 0x1a, 0x02, 0x12, 0x2f, 0x37, 0x3f, 0x07, 0x0f, 0x17, 0x1f, 0x27,
+            0xeb, 0xe3, 0xc5, 0xd5, 0xe5, 0xf5, 0xc1, 0xd1, 0xe1, 0xf1, 0x34, 0x35]
+    imm = [0x06, 0x0e, 0x16, 0x1e, 0x26, 0x2e, 0x36, 0x3e, 0xc6, 0xce, 0xd6, 0xde, 0xe6, 0xee, 0xf6, 0xfe]
+    while len(out) < 0x3000:
+        start = len(out)
+        for _ in range(rng.randrange(1, 12)):
+            r = rng.random()
+            if r < 0.7:
+                out.append(rng.choice(body))
+            elif r < 0.9:
+                out += bytes([rng.choice(imm), rng.randrange(256)])
+            else:
+                a = rng.randrange(0x0, 0x4000)
+                out += bytes([rng.choice([0x32, 0x3a, 0x22, 0x2a, 0x01, 0x11, 0x21]), a & 0xff, a >> 8])
+        target = start if rng.random() < 0.5 else rng.randrange(0, len(out))
+        op = rng.choice([0xc2, 0xca, 0xd2, 0xda, 0xe2, 0xea, 0xf2, 0xfa, 0xc4, 0xcc, 0xd4, 0xdc, 0xc3, 0xcd])
+        out += bytes([op, target & 0xff, target >> 8])
+        if rng.random() < 0.1:
+            out.append(rng.choice([0xc9, 0xc0, 0xc8, 0xd0, 0xd8, 0xe9, 0xc7, 0xcf, 0xfb, 0xf3]))
+    mem[:len(out)] = out
+    return bytes(mem)
+
+
+#Nested counted loops of random straight-line code, so blocks get hot, chain and get translated.
+def loops(seed):
+    rng = random.Random(seed)
+    avoid = {0x14, 0x15, 0x16, 0x11, 0x13, 0x1b, 0xd1, 0xeb, 0x76, 0x31, 0x33, 0x3b, 0xf9, 0xe3} | set(range(0x50, 0x58))
+    body = [x for x in range(0x40, 0xc0) if x not in avoid] + \
+           [0x04, 0x0c, 0x24, 0x2c, 0x3c, 0x05, 0x0d, 0x25, 0x2d, 0x3d, 0x03, 0x23, 0x0b, 0x2b, 0x09, 0x19, 0x29, 0x39,
+            0x0a, 0x1a, 0x02, 0x12, 0x2f, 0x37, 0x3f, 0x07, 0x0f, 0x17, 0x1f, 0x27, 0x34, 0x35]
+    imm = [0x06, 0x0e, 0x1e, 0x26, 0x2e, 0x36, 0x3e, 0xc6, 0xce, 0xd6, 0xde, 0xe6, 0xee, 0xf6, 0xfe]
+    out = bytearray([0x31, 0x00, 0xf0, 0x21, 0x00, 0x80])
+    while len(out) < 0x2000:
+        out += bytes([0x16, rng.randrange(2, 40)])              #MVI D,n
+        top = len(out)
+        for _ in range(rng.randrange(1, 30)):
+            r = rng.random()
+            if r < 0.75:
+                out.append(rng.choice(body))
+            elif r < 0.93:
+                out += bytes([rng.choice(imm), rng.randrange(256)])
+            else:
+                a = rng.randrange(0x8000, 0xf000)
+                out += bytes([rng.choice([0x32, 0x3a, 0x2a, 0x22]), a & 0xff, a >> 8])
+            if rng.random() < 0.15:
+                target = len(out) + 4
+                out += bytes([rng.choice([0xc2, 0xca, 0xd2, 0xda, 0xe2, 0xea, 0xf2, 0xfa]), target & 0xff,
+                              target >> 8, rng.choice([0x00, 0x2f, 0x3c, 0x04])])
+        out += bytes([0x15, 0xc2, top & 0xff, top >> 8])        #DCR D; JNZ top
+    out += bytes([0xc3, 0, 0])
+    return bytes(out)
+
+
+#The delay loop forms the idle loop classifier knows, then a jump to itself.
+def idle():
+    c = [0x0e, 5]                                               #MVI C,5
+    outer = len(c)
+    c += [0x06, 0]                                              #MVI B,0
+    inner = len(c)
+    c += [0x05, 0xc2] + w16(inner)                              #DCR B; JNZ inner
+    c += [0x0d, 0xc2] + w16(outer)                              #DCR C; JNZ outer
+    c += [0x11] + w16(0x1234)                                   #LXI D,1234
+    top = len(c)
+    c += [0x1b, 0x7a, 0xb3, 0xc2] + w16(top)                    #DCX D; MOV A,D; ORA E; JNZ
+    c += [0x21] + w16(0)                                        #LXI H,0
+    top = len(c)
+    c += [0x2b, 0x7d, 0xb4, 0xc2] + w16(top)                    #DCX H; MOV A,L; ORA H; JNZ
+    c += [0x3e, 0x37]                                           #MVI A,37
+    top = len(c)
+    c += [0x3d, 0xc2] + w16(top)                                #DCR A; JNZ
+    c += [0x06, 3, 0x0e, 4]                                     #MVI B,3; MVI C,4
+    top = len(c)
+    c += [0x78, 0x41, 0x4f, 0xc2] + w16(top)                    #MOV A,B; MOV B,C; MOV C,A; JNZ, which never settles
+    return bytes(c)
+
+
+#Copy and fill loops the bulk runner turns into memmove and memset, overlapping both ways, wrapping past
+#ffff and copying over the program itself.
+def bulk():
+    c = [0x31] + w16(0xf000)
+
+    def lxi(rp, v):
+        c.extend([0x01 | (rp << 4)] + w16(v))
+
+    def loop(body, counter=None, pair=None):
+        top = len(c)
+        c.extend(body)
+        if counter is not None:
+            c.extend([0x05 | (counter << 3), 0xc2] + w16(top))
+        else:
+            c.extend([0x0b | (pair << 4), 0x78 | (pair * 2), 0xb0 | (pair * 2 + 1), 0xc2] + w16(top))
+
+    lxi(2, 0x2000); lxi(1, 0x3000); c.extend([0x06, 200]); loop([0x7e, 0x12, 0x23, 0x13], counter=0)
+    lxi(2, 0x9000); lxi(0, 0x1234); loop([0x36, 0xaa, 0x23], pair=0)
+    lxi(0, 0x3000); lxi(1, 0x3003); lxi(2, 500); loop([0x0a, 0x12, 0x13, 0x03], pair=2)
+    lxi(1, 0x3010); lxi(2, 0x300b); c.extend([0x0e, 0]); loop([0x1a, 0x77, 0x23, 0x13], counter=1)
+    lxi(2, 0xa000); c.extend([0x0e, 0x5c, 0x06, 77]); loop([0x71, 0x23], counter=0)
+    lxi(0, 0xb000); c.extend([0x3e, 0x33, 0x1e, 0]); loop([0x02, 0x03], counter=3)
+    lxi(2, 0xfff8); lxi(1, 0x8000); c.extend([0x06, 0x20]); loop([0x7e, 0x12, 0x23, 0x13], counter=0)
+    lxi(2, 0x2400); lxi(1, 0x0000); c.extend([0x06, 0x30]); loop([0x7e, 0x12, 0x23, 0x13], counter=0)
+    c.extend([0x21] + w16(0x2000) + [0x34])                    #LXI H,2000; INR M, so passes differ
+    c.extend([0xc3] + w16(3))
+    img = bytearray(0x2500)
+    img[:len(c)] = bytes(c)
+    for i in range(0x100):
+        img[0x2000 + i] = (i * 37 + 11) & 0xff
+    img[0x2400:0x2430] = img[0:0x30]
+    return bytes(img)
+
+
+#Each loop shape RunIdleLoop fast-forwards, run once with a long count, then HLT. Every loop should take
+#one dispatch, so a block that runs many times is a loop that was interpreted instead.
+def fastforward():
+    c = [0x31] + w16(0xf000)
+
+    def lxi(rp, v):
+        c.extend([0x01 | (rp << 4)] + w16(v))
+
+    def loop(body, counter=None, pair=None):
+        top = len(c)
+        c.extend(body)
+        if counter is not None:
+            c.extend([0x05 | (counter << 3), 0xc2] + w16(top))
+        else:
+            c.extend([0x0b | (pair << 4), 0x78 | (pair * 2), 0xb0 | (pair * 2 + 1), 0xc2] + w16(top))
+
+    c.extend([0x06, 200]); loop([], counter=0)                                  #DCR B; JNZ
+    lxi(1, 700); loop([], pair=1)                                               #DCX D; MOV A,D; ORA E; JNZ
+    lxi(2, 0x0000); lxi(1, 0x8000); c.extend([0x06, 200]); loop([0x7e, 0x12, 0x23, 0x13], counter=0)
+    lxi(2, 0x0000); lxi(1, 0x8400); lxi(0, 300); loop([0x7e, 0x12, 0x23, 0x13], pair=0)
+    lxi(0, 0x0000); lxi(2, 0x8800); lxi(1, 300); loop([0x0a, 0x77, 0x03, 0x23], pair=1)
+    lxi(2, 0x9000); lxi(0, 300); loop([0x36, 0x5a, 0x23], pair=0)              #MVI M
+    lxi(2, 0x9400); c.extend([0x0e, 0x3c]); lxi(1, 300); loop([0x71, 0x23], pair=1)   #MOV M,C
+    lxi(0, 0x9800); c.extend([0x3e, 0x33, 0x1e, 200]); loop([0x02, 0x03], counter=3)  #STAX B
+    c.append(0x76)
+    return bytes(c)
+
+
+#Loops full of the pairs the predecoder fuses, and a loop that patches the jump of a fused pair.
+def fusions():
+    c = [0x31] + w16(0xf000)
+    c += [0x21] + w16(0x4000) + [0x11] + w16(0x5000) + [0x01] + w16(0x6000)
+    c += [0x0e, 40]
+    top = len(c)
+    c += [0x7e, 0x23, 0x77, 0x23, 0x1a, 0x02, 0x0a, 0x12, 0x1a, 0x77]
+    c += [0xe5, 0xd1, 0xd5, 0xe1]                               #PUSH H; POP D; PUSH D; POP H
+    c += [0xfe, 0x80, 0xda] + w16(len(c) + 6) + [0x3c]          #CPI 80; JC; INR A
+    c += [0xfe, 0x10, 0xca] + w16(len(c) + 6) + [0x3c]          #CPI 10; JZ; INR A
+    c += [0xa7, 0xca] + w16(len(c) + 4)                         #ANA A; JZ
+    c += [0xb7, 0xc2] + w16(len(c) + 3)                         #ORA A; JNZ
+    c += [0x01] + w16(0x0300)
+    delay = len(c)
+    c += [0x0b, 0x78, 0xb1, 0xc2] + w16(delay)                  #DCX B; MOV A,B; ORA C; JNZ
+    c += [0x01] + w16(0x6000)
+    c += [0x0d, 0xc2] + w16(top)                                #DCR C; JNZ top
+    patch = len(c)
+    c += [0x06, 3]
+    inner = len(c)
+    c += [0x3e, 0xca, 0x32] + w16(inner + 8)                    #MVI A,JZ; STA over the JNZ below
+    c += [0x15, 0xc2] + w16(inner)                              #DCR D; JNZ inner, or JZ once patched
+    c += [0x3e, 0xc2, 0x32] + w16(inner + 8)
+    c += [0x05, 0xc2] + w16(patch)                              #DCR B; JNZ patch
+    c += [0x0e, 40, 0xc3] + w16(top)
+    return bytes(c)
+
+
+#Adds up the bytes IN returns in memory at 4000, sending each running sum to OUT, until IN returns 0;
+#then sends the sum again and halts. A job's output shows which input it ran with, and a job that ran on
+#memory a previous job left behind starts from the wrong sum.
+def echo():
+    c = [0x31] + w16(0xf000)                    #LXI SP,f000
+    top = len(c)
+    c += [0xdb, 0, 0xb7, 0xca] + w16(top + 16)  #IN 0; ORA A; JZ done
+    c += [0x21] + w16(0x4000) + [0x86, 0x77]    #LXI H,4000; ADD M; MOV M,A
+    c += [0xd3, 1, 0xc3] + w16(top)             #OUT 1; JMP top
+    c += [0x3a] + w16(0x4000) + [0xd3, 2, 0x76] #done: LDA 4000; OUT 2; HLT
+    return bytes(c)
+
+
+#Spins DCR B as many times as the first byte IN returns, then halts unless the next ones spell FUZZ. The
+#fuzzer finds new coverage in the counts of the fast-forwarded loop and in each letter it gets right.
+def maze():
+    c = [0x31] + w16(0xf000)                    #LXI SP,f000
+    c += [0xdb, 0, 0x47]                        #IN 0; MOV B,A
+    top = len(c)
+    c += [0x05, 0xc2] + w16(top)                #DCR B; JNZ top
+    done = len(c) + 7 * 4 + 4
+    for letter in b"FUZZ":
+        c += [0xdb, 0, 0xfe, letter, 0xc2] + w16(done)  #IN 0; CPI letter; JNZ done
+    c += [0x3e, 1, 0xd3, 1]                     #MVI A,1; OUT 1
+    c += [0x76]                                 #done: HLT
+    return bytes(c)
+
+
+#Stays inside the Space Invaders map -m sets up, 8K of ROM and the first 8K of RAM, so it ends the same
+#under -m as with flat memory: stores to 2180 and reads it back, copies a ROM table into RAM and adds it
+#up in a subroutine, then halts.
+def invaders():
+    c = [0x31] + w16(0x2400)                    #LXI SP,2400
+    c += [0x3e, 0x5a, 0x32] + w16(0x2180)       #MVI A,5a; STA 2180
+    c += [0x3a] + w16(0x2180)                   #LDA 2180
+    c += [0x3c, 0x32] + w16(0x2180)             #INR A; STA 2180
+    c += [0x21] + w16(0x1000) + [0x11] + w16(0x2200) + [0x06, 0]
+    top = len(c)
+    c += [0x7e, 0x12, 0x23, 0x13, 0x05, 0xc2] + w16(top)        #MOV A,M; STAX D; INX H; INX D; DCR B; JNZ
+    call = len(c)
+    c += [0xcd] + w16(call + 4) + [0x76]        #CALL sum; HLT
+    c += [0x21] + w16(0x2200) + [0x06, 0, 0xaf] #sum: LXI H,2200; MVI B,0; XRA A
+    top = len(c)
+    c += [0x86, 0x23, 0x05, 0xc2] + w16(top)    #ADD M; INX H; DCR B; JNZ
+    c += [0x4f, 0xc9]                           #MOV C,A; RET
+    img = bytearray(0x1100)
+    img[:len(c)] = bytes(c)
+    for i in range(0x100):
+        img[0x1000 + i] = (i * 37 + 11) & 0xff
+    return bytes(img)
+
+
+#A program assembled to run at origin, like a CP/M .com file at 0100: adds up its own code, calls a
+#subroutine that loads a byte from its data and halts with e 5a. Loaded anywhere else it runs into
+#whatever the jumps miss.
+def relocated(origin):
+    c = [0x31] + w16(0xf000)                    #LXI SP,f000
+    c += [0x21] + w16(origin) + [0x06, 0, 0xaf] #LXI H,origin; MVI B,length; XRA A
+    top = origin + len(c)
+    c += [0x86, 0x23, 0x05, 0xc2] + w16(top)    #ADD M; INX H; DCR B; JNZ
+    sub = origin + len(c) + 5
+    c += [0x4f, 0xcd] + w16(sub) + [0x76]       #MOV C,A; CALL sub; HLT
+    c += [0x3a] + w16(sub + 5) + [0x5f, 0xc9]   #sub: LDA data; MOV E,A; RET
+    c += [0x5a]                                 #data
+    c[7] = len(c)
+    return bytes(c)
+
+
+IMAGES = {
+    "alu.bin": alu(),
+    "branches.bin": branches(1),
+    "opcodes.bin": opcodes(1),
+    "selfmodifying.bin": selfmodifying(1),
+    "loops.bin": loops(1),
+    "idle.bin": idle(),
+    "bulk.bin": bulk(),
+    "fusions.bin": fusions(),
+    "fastforward.bin": fastforward(),
+    "echo.bin": echo(),
+    "maze.bin": maze(),
+    "invaders.bin": invaders(),
+    "relocated_100.com": relocated(0x100),
+    "relocated_1000.com": relocated(0x1000),
+}
+
+for name, image in IMAGES.items():
+    with open(os.path.join(sys.argv[1], name), "wb") as out:
+        out.write(image)
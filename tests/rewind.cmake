@@ -0,0 +1,32 @@
+#Runs EMULATOR on IMAGE for CYCLES with -w, which seeks back to the halfway point, and fails unless
+#the state it seeks to is the one -r reaches in half the cycles. With HISTORY set the ring holds that
+#many bytes, and the run must have wrapped it at least once.
+#cmake -DEMULATOR=... -DCYCLES=... -DIMAGE=... [-DHISTORY=...] -P rewind.cmake
+math(EXPR half "${CYCLES} / 2")
+set(options)
+if (DEFINED HISTORY)
+    set(options -H ${HISTORY})
+endif ()
+foreach (run "-r;${half}" "${options};-w;${CYCLES}")
+    execute_process(COMMAND ${EMULATOR} ${run} ${IMAGE}
+                    OUTPUT_VARIABLE output
+                    RESULT_VARIABLE status)
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "${run} exited with ${status}")
+    endif ()
+    list(APPEND outputs "${output}")
+endforeach ()
+
+#-w prints the end of the run and then the state it sought back to; -r also counts instructions.
+list(GET outputs 0 straight)
+list(GET outputs 1 rewound)
+string(REGEX MATCH "^[^\n]*" straight "${straight}")
+string(REGEX REPLACE " instructions [0-9]+" "" straight "${straight}")
+string(REGEX MATCH "^[^\n]*\n([^\n]*)" sought "${rewound}")
+set(sought "${CMAKE_MATCH_1}")
+if (NOT sought STREQUAL straight)
+    message(FATAL_ERROR "-w seeks back to a different state\n-r  ${straight}\n-w  ${sought}")
+endif ()
+if (DEFINED HISTORY AND rewound MATCHES " wraps 0 ")
+    message(FATAL_ERROR "the run never wrapped a ${HISTORY} byte ring")
+endif ()
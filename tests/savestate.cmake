@@ -0,0 +1,22 @@
+#Runs EMULATOR on IMAGE for CYCLES with -r, then again with MODE, saving the state halfway and resuming
+#from it in a second process, and fails unless both end in the same state and cycle count.
+#cmake -DEMULATOR=... -DMODE=-b -DCYCLES=... -DIMAGE=... -DSTATE=... -P savestate.cmake
+math(EXPR half "${CYCLES} / 2")
+foreach (run "-r;${CYCLES}" "-S;${STATE};${MODE};${half}" "-L;${STATE};${MODE};${CYCLES}")
+    execute_process(COMMAND ${EMULATOR} ${run} ${IMAGE}
+                    OUTPUT_VARIABLE output
+                    RESULT_VARIABLE status)
+    if (NOT status EQUAL 0)
+        message(FATAL_ERROR "${run} exited with ${status}")
+    endif ()
+    #Instructions are only counted within a process, so they are left out of the comparison.
+    string(REGEX MATCH "^[^\n]*" line "${output}")
+    string(REGEX REPLACE " instructions [0-9]+" "" line "${line}")
+    list(APPEND lines "${line}")
+endforeach ()
+
+list(GET lines 0 straight)
+list(GET lines 2 resumed)
+if (NOT resumed STREQUAL straight)
+    message(FATAL_ERROR "a run resumed from a saved state ends elsewhere\nstraight  ${straight}\nresumed   ${resumed}")
+endif ()
@@ -0,0 +1,13 @@
+#Runs EMULATOR on IMAGE for CYCLES with -m, watching ADDRESS, and fails unless it reports HITS accesses
+#and the first of them is FIRST, e.g. "write 2180 value 5a pc 0008".
+#cmake -DEMULATOR=... -DCYCLES=... -DIMAGE=... -DADDRESS=... -DHITS=... -DFIRST=... -P watch.cmake
+execute_process(COMMAND ${EMULATOR} -W ${ADDRESS} -m ${CYCLES} ${IMAGE}
+                OUTPUT_VARIABLE output
+                RESULT_VARIABLE status)
+if (NOT status EQUAL 0)
+    message(FATAL_ERROR "-W ${ADDRESS} -m exited with ${status}")
+endif ()
+string(REGEX MATCH "\nwatch hits ([0-9]+)\n([^\n]*)" line "${output}")
+if (NOT CMAKE_MATCH_1 STREQUAL HITS OR NOT CMAKE_MATCH_2 STREQUAL FIRST)
+    message(FATAL_ERROR "expected ${HITS} hits, the first \"${FIRST}\"\n${output}")
+endif ()